@@ -0,0 +1,475 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <string_view>
+#include <span>
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <ranges>
+#include <random>
+#include <format>
+#include <cctype>
+#include <cstdint>
+#include <chrono>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#include "params.hxx"
+#include "mem-map-file.hxx"
+#include "compact-table.hxx"
+#include "kernels.hxx"
+
+// Each hot-path building block of the word-count pipeline, run over realistic buffers of L1, L2, L3 and DRAM size.
+// Every kernel reports bytes/s and cycles/byte of the *input text*, so the per-kernel numbers of one buffer add up
+// to the whole pipeline and a regression can be pinned on a single kernel.
+
+namespace r = std::ranges;
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+using std::string;
+using std::string_view;
+using ribomation::wordcount::Params;
+using ribomation::wordcount::CompactWordTable;
+using ribomation::wordcount::TokenClass;
+using ribomation::wordcount::mem_map::WordIterator;
+namespace policy = ribomation::wordcount::policy;
+namespace kernels = ribomation::wordcount::kernels;
+
+
+// --- input texts ---
+enum class Text { english, random, adversarial };
+
+static auto text_name(Text kind) -> string_view {
+    switch (kind) {
+        case Text::english: return "english"sv;
+        case Text::random: return "random"sv;
+        case Text::adversarial: return "adversarial"sv;
+    }
+    return "?"sv;
+}
+
+// English-like: common words drawn with Zipf frequencies, capitalized sentences, punctuation and line breaks.
+static auto english_text(size_t size, std::mt19937_64& R) -> string {
+    static constexpr auto vocabulary = std::array{
+        "the"sv, "and"sv, "to"sv, "of"sv, "a"sv, "i"sv, "you"sv, "my"sv, "that"sv, "in"sv, "is"sv, "not"sv,
+        "with"sv, "me"sv, "it"sv, "for"sv, "be"sv, "his"sv, "your"sv, "this"sv, "but"sv, "he"sv, "have"sv,
+        "as"sv, "thou"sv, "so"sv, "him"sv, "will"sv, "what"sv, "thy"sv, "all"sv, "her"sv, "no"sv, "by"sv,
+        "do"sv, "shall"sv, "if"sv, "are"sv, "we"sv, "thee"sv, "our"sv, "lord"sv, "on"sv, "king"sv, "good"sv,
+        "now"sv, "sir"sv, "from"sv, "come"sv, "at"sv, "they"sv, "she"sv, "let"sv, "enter"sv, "here"sv,
+        "would"sv, "there"sv, "more"sv, "love"sv, "which"sv, "when"sv, "then"sv, "them"sv, "well"sv,
+        "their"sv, "man"sv, "how"sv, "know"sv, "say"sv, "hath"sv, "make"sv, "like"sv, "upon"sv, "speak"sv,
+        "night"sv, "should"sv, "heaven"sv, "father"sv, "death"sv, "honour"sv, "nothing"sv, "great"sv,
+        "there's"sv, "'tis"sv, "don't"sv, "gentleman"sv, "something"sv, "majesty"sv, "nevertheless"sv,
+        "brother"sv, "answer"sv, "daughter"sv, "business"sv, "company"sv, "another"sv, "fortune"sv,
+        "remember"sv, "presently"sv, "therefore"sv, "gracious"sv, "patience"sv, "soldiers"sv, "himself"sv,
+    };
+    auto weights = std::vector<double>(vocabulary.size());
+    for (auto k = 0UL; k < weights.size(); ++k) weights[k] = 1.0 / static_cast<double>(k + 1);
+    auto word_of = std::discrete_distribution<size_t>{weights.begin(), weights.end()};
+    auto percent = std::uniform_int_distribution<unsigned>{0, 99};
+
+    auto text = string{};
+    text.reserve(size + 64);
+    auto sentence_start = true;
+    auto line = 0UL;
+    while (text.size() < size) {
+        auto word = string{vocabulary[word_of(R)]};
+        if (sentence_start) word[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(word[0])));
+        text += word;
+        line += word.size();
+        auto p = percent(R);
+        sentence_start = p < 8;
+        if (p < 8) text += p < 6 ? '.' : '?';
+        else if (p < 16) text += ',';
+        if (line > 70) {
+            text += '\n';
+            line = 0;
+        } else {
+            text += ' ';
+            ++line;
+        }
+    }
+    text.resize(size);
+    return text;
+}
+
+// A huge vocabulary: random mixed-case words of 1..12 letters, single-space separated.
+static auto random_text(size_t size, std::mt19937_64& R) -> string {
+    auto length = std::uniform_int_distribution<unsigned>{1, 12};
+    auto letter = std::uniform_int_distribution<unsigned>{0, 51};
+    auto text = string{};
+    text.reserve(size + 16);
+    while (text.size() < size) {
+        for (auto n = length(R); n > 0; --n) {
+            auto k = letter(R);
+            text += static_cast<char>(k < 26 ? 'a' + k : 'A' + k - 26);
+        }
+        text += ' ';
+    }
+    text.resize(size);
+    return text;
+}
+
+// Every byte independently a letter or not (incl. apostrophes and high-bit bytes): no branch is predictable
+// and tokens are tiny, the worst case for classification and splitting.
+static auto adversarial_text(size_t size, std::mt19937_64& R) -> string {
+    static constexpr auto letters = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ'"sv;
+    static constexpr auto others = " \n\t.,;:!?-0123456789\xC3\xA9\xE2\x80\x94"sv;
+    auto coin = std::bernoulli_distribution{0.5};
+    auto pick_letter = std::uniform_int_distribution<size_t>{0, letters.size() - 1};
+    auto pick_other = std::uniform_int_distribution<size_t>{0, others.size() - 1};
+    auto text = string(size, ' ');
+    for (auto& c: text) c = coin(R) ? letters[pick_letter(R)] : others[pick_other(R)];
+    return text;
+}
+
+
+// --- the workload of one (text, size), built once and shared by all kernels ---
+struct Token {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct Workload {
+    Text kind{};
+    size_t size = 0;
+    string text{};                  // original
+    string folded{};                // lower-cased copy, the tokens point into it
+    string scratch{};               // output buffer for kernels that write
+    std::vector<Token> tokens{};    // all [A-Za-z']+ runs, no length or stop-word filtering
+    std::vector<std::pair<string_view, unsigned>> counted{};
+
+    [[nodiscard]] auto word(Token t) const -> string_view { return string_view{folded}.substr(t.offset, t.length); }
+};
+
+static bool is_letter_orig(char c) {
+    const auto ch = static_cast<unsigned char>(c);
+    return std::isalpha(ch) || ch == '\'';
+}
+
+static char to_lower_orig(char c) {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+// The splitting loop of WordIterator without its length and stop-word filtering.
+template<typename Consumer>
+static void split(string_view text, Consumer&& consume) {
+    auto pos = 0UL;
+    while (true) {
+        while (pos < text.size() && not WordIterator::is_letter(text[pos])) ++pos;
+        if (pos == text.size()) return;
+        auto start = pos;
+        while (pos < text.size() && WordIterator::is_letter(text[pos])) ++pos;
+        consume(start, pos - start);
+    }
+}
+
+// Only one workload is resident at a time, benchmarks are registered grouped by workload.
+static auto workload(Text kind, size_t size) -> Workload& {
+    static auto w = Workload{};
+    if (w.kind == kind && w.size == size) return w;
+
+    auto R = std::mt19937_64{42};
+    w = Workload{kind, size};
+    switch (kind) {
+        case Text::english: w.text = english_text(size, R); break;
+        case Text::random: w.text = random_text(size, R); break;
+        case Text::adversarial: w.text = adversarial_text(size, R); break;
+    }
+    w.folded = w.text;
+    kernels::fold_to_lower(w.folded);
+    w.scratch = w.text;
+    split(w.folded, [](size_t offset, size_t length) {
+        w.tokens.push_back(Token{static_cast<uint32_t>(offset), static_cast<uint32_t>(length)});
+    });
+
+    auto freqs = std::unordered_map<string_view, unsigned>{};
+    for (auto t: w.tokens) ++freqs[w.word(t)];
+    w.counted.assign(freqs.begin(), freqs.end());
+    return w;
+}
+
+
+// --- measurement ---
+static auto read_tsc() -> uint64_t {
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Reports bytes/s and cycles/byte, the latter in TSC (reference) cycles, i.e. not scaled by turbo frequency.
+// On non-x86 hosts the counter falls back to nanoseconds/byte.
+class Throughput {
+    benchmark::State& state;
+    uint64_t start;
+
+public:
+    explicit Throughput(benchmark::State& state_) : state(state_), start(read_tsc()) {}
+
+    void report(size_t bytes_per_iteration) {
+        auto cycles = static_cast<double>(read_tsc() - start);
+        auto bytes = static_cast<double>(state.iterations()) * static_cast<double>(bytes_per_iteration);
+        state.SetBytesProcessed(static_cast<int64_t>(bytes));
+        state.counters["cycles/byte"] = cycles / bytes;
+    }
+};
+
+
+// --- kernels ---
+static void classify_isalpha(benchmark::State& state, Text kind, size_t size) {
+    auto const& w = workload(kind, size);
+    auto tp = Throughput{state};
+    for (auto _ : state) {
+        auto letters = r::count_if(w.text, is_letter_orig);
+        benchmark::DoNotOptimize(letters);
+    }
+    tp.report(w.text.size());
+}
+
+static void classify_range(benchmark::State& state, Text kind, size_t size) {
+    auto const& w = workload(kind, size);
+    auto tp = Throughput{state};
+    for (auto _ : state) {
+        auto letters = r::count_if(w.text, policy::RangeCompare::is_letter);
+        benchmark::DoNotOptimize(letters);
+    }
+    tp.report(w.text.size());
+}
+
+static void classify_table(benchmark::State& state, Text kind, size_t size) {
+    auto const& w = workload(kind, size);
+    auto tp = Throughput{state};
+    for (auto _ : state) {
+        auto letters = r::count_if(w.text, policy::AsciiLetters::is_letter);
+        benchmark::DoNotOptimize(letters);
+    }
+    tp.report(w.text.size());
+}
+
+static void lowercase_tolower(benchmark::State& state, Text kind, size_t size) {
+    auto& w = workload(kind, size);
+    auto tp = Throughput{state};
+    for (auto _ : state) {
+        r::transform(w.text, w.scratch.begin(), to_lower_orig);
+        benchmark::ClobberMemory();
+    }
+    tp.report(w.text.size());
+}
+
+static void lowercase_fold(benchmark::State& state, Text kind, size_t size) {
+    auto& w = workload(kind, size);
+    auto tp = Throughput{state};
+    for (auto _ : state) {
+        kernels::fold_to_lower(w.scratch);      // branch-free, so re-folding folded bytes costs the same
+        benchmark::ClobberMemory();
+    }
+    tp.report(w.text.size());
+}
+
+static void split_words(benchmark::State& state, Text kind, size_t size) {
+    auto const& w = workload(kind, size);
+    auto tp = Throughput{state};
+    for (auto _ : state) {
+        auto num_words = 0UL;
+        split(w.folded, [&num_words](size_t, size_t) { ++num_words; });
+        benchmark::DoNotOptimize(num_words);
+    }
+    tp.report(w.text.size());
+}
+
+static void filter_stop_words(benchmark::State& state, Text kind, size_t size) {
+    static auto const modern_words = std::unordered_set<string_view>{
+        "electronic"sv, "distributed"sv, "copies"sv, "copyright"sv, "gutenberg"sv
+    };
+    auto const& w = workload(kind, size);
+    auto const min_length = Params{}.min_length;
+    auto tp = Throughput{state};
+    for (auto _ : state) {
+        auto kept = 0UL;
+        for (auto t: w.tokens) {
+            if (t.length >= min_length && not modern_words.contains(w.word(t))) ++kept;
+        }
+        benchmark::DoNotOptimize(kept);
+    }
+    tp.report(w.text.size());
+}
+
+// The complete tokenizer as one WordIterator policy combination, so the steps compare like with like.
+// Folding in place runs over the scratch copy, which costs the same once it is folded.
+template<typename CharClass, typename CaseFold, typename Filter, unsigned MinLength = ribomation::wordcount::runtime_min_length>
+static void tokenize(benchmark::State& state, Text kind, size_t size) {
+    using Iterator = ribomation::wordcount::WordIterator<std::span<char>, CharClass, CaseFold, Filter, MinLength>;
+    auto& w = workload(kind, size);
+    auto& payload = CaseFold::in_place ? w.scratch : w.folded;
+    auto const min_length = Params{}.min_length;
+    auto tp = Throughput{state};
+    for (auto _ : state) {
+        auto num_words = 0UL;
+        for (auto it = Iterator{payload, min_length}; it != Iterator{}; ++it) ++num_words;
+        benchmark::DoNotOptimize(num_words);
+    }
+    tp.report(w.text.size());
+}
+
+// The same, with a wider --token-spec; the nibble lookups cost the same whatever the set.
+static void tokenize_hashtags(benchmark::State& state, Text kind, size_t size) {
+    policy::Configured::use(TokenClass{TokenClass::preset("hashtags")});
+    tokenize<policy::Configured, policy::PreFolded, policy::NotModern>(state, kind, size);
+    policy::Configured::use(TokenClass{ribomation::wordcount::default_token_chars});
+}
+
+static void hash_words(benchmark::State& state, Text kind, size_t size) {
+    auto const& w = workload(kind, size);
+    auto tp = Throughput{state};
+    for (auto _ : state) {
+        auto h = 0UL;
+        for (auto t: w.tokens) h ^= std::hash<string_view>{}(w.word(t));
+        benchmark::DoNotOptimize(h);
+    }
+    tp.report(w.text.size());
+}
+
+static void insert_hash_map(benchmark::State& state, Text kind, size_t size) {
+    auto const& w = workload(kind, size);
+    auto tp = Throughput{state};
+    for (auto _ : state) {
+        auto freqs = std::unordered_map<string_view, unsigned>{};
+        freqs.reserve(w.counted.size());
+        for (auto t: w.tokens) ++freqs[w.word(t)];
+        benchmark::DoNotOptimize(freqs);
+    }
+    tp.report(w.text.size());
+}
+
+static void insert_compact_table(benchmark::State& state, Text kind, size_t size) {
+    auto const& w = workload(kind, size);
+    auto tp = Throughput{state};
+    for (auto _ : state) {
+        auto freqs = CompactWordTable{w.folded, w.counted.size()};
+        for (auto t: w.tokens) freqs.add(w.word(t));
+        benchmark::DoNotOptimize(freqs);
+    }
+    tp.report(w.text.size());
+}
+
+static void top_k(benchmark::State& state, Text kind, size_t size) {
+    auto const& w = workload(kind, size);
+    auto const N = std::min<size_t>(Params{}.max_words, w.counted.size());
+    auto top = std::vector<std::pair<string_view, unsigned>>(N);
+    auto tp = Throughput{state};
+    for (auto _ : state) {
+        r::partial_sort_copy(w.counted, top, [](auto const& a, auto const& b) { return a.second > b.second; });
+        benchmark::DoNotOptimize(top);
+    }
+    tp.report(w.text.size());
+}
+
+// The span tags of the top words, as the engines render them; here the bytes are those of the html produced.
+static void render_span_tags(benchmark::State& state, Text kind, size_t size) {
+    auto const& w = workload(kind, size);
+    auto const params = Params{};
+    auto top = w.counted;
+    auto const N = std::min<size_t>(params.max_words, top.size());
+    r::partial_sort(top, top.begin() + N, [](auto const& a, auto const& b) { return a.second > b.second; });
+    top.resize(N);
+    auto const max_freq = top.front().second;
+    auto const min_freq = top.back().second;
+    auto const scale = static_cast<double>(params.max_font - params.min_font) / std::max(max_freq - min_freq, 1U);
+    auto R = std::default_random_engine{42};
+    auto Byte = std::uniform_int_distribution<unsigned short>{0, 255};
+
+    auto html_size = 0UL;
+    auto tp = Throughput{state};
+    for (auto _ : state) {
+        auto html = string{};
+        html.reserve(500 + (top.size() * 150));
+        for (auto const& [word, freq]: top) {
+            auto size_px = static_cast<unsigned>((freq - min_freq) * scale + params.min_font);
+            auto color = std::format("#{:02X}{:02X}{:02X}", Byte(R), Byte(R), Byte(R));
+            constexpr auto fmt =
+                    R"(<span style="font-size: {}px; color: {};" title="The word '{}' occurs {} times">{}</span>)";
+            html += std::format(fmt, size_px, color, word, freq, word) + "\n";
+        }
+        html_size = html.size();
+        benchmark::DoNotOptimize(html);
+    }
+    tp.report(html_size);
+}
+
+
+// --- registration: L1, L2 and L3 buffers of half the cache size, DRAM at 4x L3 (at most 128 MB) ---
+static auto buffer_sizes() -> std::vector<size_t> {
+    auto cache_size = [](int level, size_t fallback) {
+        for (auto const& cache: benchmark::CPUInfo::Get().caches) {
+            if (cache.level == level && cache.type != "Instruction"s) return static_cast<size_t>(cache.size);
+        }
+        return fallback;
+    };
+    auto const L1 = cache_size(1, 32UL << 10);
+    auto const L2 = cache_size(2, 1UL << 20);
+    auto const L3 = cache_size(3, 16UL << 20);
+    auto const max_size = 128UL << 20;
+
+    auto sizes = std::vector<size_t>{};
+    for (auto size: {L1 / 2, L2 / 2, L3 / 2, 4 * L3}) {
+        size = std::min(size, max_size);
+        if (sizes.empty() || size > sizes.back()) sizes.push_back(size);
+    }
+    return sizes;
+}
+
+static auto size_name(size_t size) -> string {
+    if (size >= (1UL << 20)) return std::format("{}M", size >> 20);
+    return std::format("{}K", size >> 10);
+}
+
+int main(int argc, char* argv[]) {
+    using Kernel = void (*)(benchmark::State&, Text, size_t);
+    static constexpr auto kernels = std::array{
+        std::pair{"classify/isalpha"sv, Kernel{classify_isalpha}},
+        std::pair{"classify/range"sv, Kernel{classify_range}},
+        std::pair{"classify/table"sv, Kernel{classify_table}},
+        std::pair{"lowercase/tolower"sv, Kernel{lowercase_tolower}},
+        std::pair{"lowercase/fold"sv, Kernel{lowercase_fold}},
+        std::pair{"split"sv, Kernel{split_words}},
+        std::pair{"stop-words"sv, Kernel{filter_stop_words}},
+        std::pair{"tokenize/isalpha+tolower"sv,
+                  Kernel{tokenize<policy::LocaleAlpha, policy::LocaleFold, policy::NotModern>}},
+        std::pair{"tokenize/range+fold"sv,
+                  Kernel{tokenize<policy::RangeCompare, policy::FoldInPlace, policy::NotModern>}},
+        std::pair{"tokenize/table+fold"sv,
+                  Kernel{tokenize<policy::AsciiLetters, policy::FoldInPlace, policy::NotModern>}},
+        std::pair{"tokenize/table+prefolded"sv,
+                  Kernel{tokenize<policy::AsciiLetters, policy::PreFolded, policy::NotModern>}},
+        std::pair{"tokenize/table+prefolded+min6"sv,
+                  Kernel{tokenize<policy::AsciiLetters, policy::PreFolded, policy::NotModern, 6>}},
+        std::pair{"tokenize/nibbles+fold"sv,
+                  Kernel{tokenize<policy::Configured, policy::FoldInPlace, policy::NotModern>}},
+        std::pair{"tokenize/nibbles+prefolded"sv,
+                  Kernel{tokenize<policy::Configured, policy::PreFolded, policy::NotModern>}},
+        std::pair{"tokenize/nibbles-hashtags+prefolded"sv, Kernel{tokenize_hashtags}},
+        std::pair{"hash"sv, Kernel{hash_words}},
+        std::pair{"insert/unordered_map"sv, Kernel{insert_hash_map}},
+        std::pair{"insert/compact-table"sv, Kernel{insert_compact_table}},
+        std::pair{"top-k/partial_sort"sv, Kernel{top_k}},
+        std::pair{"span-tags"sv, Kernel{render_span_tags}},
+    };
+
+    benchmark::Initialize(&argc, argv);
+    for (auto size: buffer_sizes()) {
+        for (auto kind: {Text::english, Text::random, Text::adversarial}) {
+            for (auto [name, kernel]: kernels) {
+                auto label = std::format("{}/{}/{}", name, text_name(kind), size_name(size));
+                benchmark::RegisterBenchmark(label.c_str(), kernel, kind, size)->Unit(benchmark::kMicrosecond);
+            }
+        }
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+}
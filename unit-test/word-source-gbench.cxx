@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <filesystem>
+#include <iterator>
+#include "params.hxx"
+#include "mem-map-file.hxx"
+#include "word-source.hxx"
+#include "kernels.hxx"
+
+// The std::generator word sources against the hand-written iterator, over the same corpus; the words are counted,
+// not stored. Run with --benchmark_repetitions=N to get the mean, median and stddev of each, rather than N rows.
+
+namespace ribomation::wordcount::coroutine {
+    extern auto run(Params const& P) -> std::string;
+}
+using ribomation::wordcount::Params;
+namespace source = ribomation::wordcount::source;
+
+
+static auto folded_corpus() -> std::string& {
+    static auto text = [] {
+        auto in = std::ifstream{Params{}.filename};
+        auto result = std::string{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+        ribomation::wordcount::kernels::fold_to_lower(result);
+        return result;
+    }();
+    return text;
+}
+
+static void iterator_source_bm(benchmark::State& state) {
+    auto& text = folded_corpus();
+    using ribomation::wordcount::mem_map::WordIterator;
+    for (auto _ : state) {
+        auto num_words = 0UL;
+        for (auto it = WordIterator{text, Params{}.min_length}; it != WordIterator{}; ++it) ++num_words;
+        benchmark::DoNotOptimize(num_words);
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(iterator_source_bm)->Unit(benchmark::kMillisecond)->ReportAggregatesOnly()
+        ->Name("Source: hand-written WordIterator, in memory");
+
+static void generator_source_bm(benchmark::State& state) {
+    auto& text = folded_corpus();
+    for (auto _ : state) {
+        auto num_words = 0UL;
+        for (auto word: source::words(text, Params{}.min_length)) num_words += not word.empty();
+        benchmark::DoNotOptimize(num_words);
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(generator_source_bm)->Unit(benchmark::kMillisecond)->ReportAggregatesOnly()
+        ->Name("Source: std::generator, in memory");
+
+static void blocks_source_bm(benchmark::State& state) {
+    auto const params = Params{};
+    for (auto _ : state) {
+        auto num_words = 0UL;
+        for (auto word: source::words(source::blocks(params.filename, 1024 * 1024), params.min_length)) num_words += not word.empty();
+        benchmark::DoNotOptimize(num_words);
+    }
+    state.SetBytesProcessed(state.iterations() * std::filesystem::file_size(params.filename));
+}
+BENCHMARK(blocks_source_bm)->Unit(benchmark::kMillisecond)->ReportAggregatesOnly()
+        ->Name("Source: std::generator, blocks read when pulled");
+
+static void prefetched_source_bm(benchmark::State& state) {
+    auto const params = Params{};
+    for (auto _ : state) {
+        auto num_words = 0UL;
+        for (auto word: source::words(source::prefetched_blocks(params.filename, 1024 * 1024), params.min_length)) num_words += not word.empty();
+        benchmark::DoNotOptimize(num_words);
+    }
+    state.SetBytesProcessed(state.iterations() * std::filesystem::file_size(params.filename));
+}
+BENCHMARK(prefetched_source_bm)->Unit(benchmark::kMillisecond)->ReportAggregatesOnly()
+        ->Name("Source: std::generator, prefetched blocks");
+
+static void coroutine_bm(benchmark::State& state) {
+    auto params = Params{};
+    for (auto _ : state) {
+        auto html = ribomation::wordcount::coroutine::run(params);
+        benchmark::DoNotOptimize(html);
+    }
+}
+BENCHMARK(coroutine_bm)->Unit(benchmark::kMillisecond)->ReportAggregatesOnly()
+        ->Name("Coroutine word source, prefetched reads");
+
+BENCHMARK_MAIN();
@@ -1,5 +1,15 @@
 #include <benchmark/benchmark.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <filesystem>
+#include <iterator>
 #include "params.hxx"
+#include "mem-map-file.hxx"
+#include "adaptive-radix-tree.hxx"
+#include "compact-table.hxx"
 
 namespace ribomation::wordcount::baseline {
     extern auto run(Params const& P) -> std::string;
@@ -13,6 +23,18 @@ namespace ribomation::wordcount::char_fn {
 namespace ribomation::wordcount::mem_map {
     extern auto run(Params const& P) -> std::string;
 }
+namespace ribomation::wordcount::multi_proc {
+    extern auto run(Params const& P) -> std::string;
+}
+namespace ribomation::wordcount::ngram {
+    extern auto run(Params const& P) -> std::string;
+}
+namespace ribomation::wordcount::concordance {
+    extern auto run(Params const& P) -> std::string;
+}
+namespace ribomation::wordcount::radix_tree {
+    extern auto run(Params const& P) -> std::string;
+}
 using ribomation::wordcount::Params;
 
 
@@ -52,4 +74,146 @@ static void memmap_bm(benchmark::State& state) {
 }
 BENCHMARK(memmap_bm)->Unit(benchmark::kMillisecond)->Name("Memory-mapped file");
 
+static void memmap_dump_bm(benchmark::State& state) {
+    auto params = Params{};
+    params.dump_file = "/dev/null";
+    for (auto _ : state) {
+        auto html = ribomation::wordcount::mem_map::run(params);
+        benchmark::DoNotOptimize(html);
+    }
+}
+BENCHMARK(memmap_dump_bm)->Unit(benchmark::kMillisecond)->Name("Memory-mapped file, full ranked dump");
+
+static void multiproc_bm(benchmark::State& state) {
+    auto params = Params{};
+    for (auto _ : state) {
+        auto html = ribomation::wordcount::multi_proc::run(params);
+        benchmark::DoNotOptimize(html);
+    }
+}
+BENCHMARK(multiproc_bm)->Unit(benchmark::kMillisecond)->Name("Multi-process map-reduce");
+
+static void bigram_bm(benchmark::State& state) {
+    auto params = Params{};
+    params.ngram = 2;
+    for (auto _ : state) {
+        auto html = ribomation::wordcount::ngram::run(params);
+        benchmark::DoNotOptimize(html);
+    }
+}
+BENCHMARK(bigram_bm)->Unit(benchmark::kMillisecond)->Name("Bigrams (memory-mapped)");
+
+static void concordance_bm(benchmark::State& state) {
+    auto params = Params{};
+    params.cache_dir = std::filesystem::temp_directory_path() / "wordcount-gbench-postings";
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::filesystem::remove_all(params.cache_dir);
+        state.ResumeTiming();
+        auto html = ribomation::wordcount::concordance::run(params);
+        benchmark::DoNotOptimize(html);
+    }
+}
+BENCHMARK(concordance_bm)->Unit(benchmark::kMillisecond)->Name("Positional index (memory-mapped)");
+
+static void concordance_query_bm(benchmark::State& state) {
+    auto params = Params{};
+    params.cache_dir = std::filesystem::temp_directory_path() / "wordcount-gbench-postings";
+    params.context_word = "exeunt";
+    ribomation::wordcount::concordance::run(params);
+    for (auto _ : state) {
+        auto html = ribomation::wordcount::concordance::run(params);
+        benchmark::DoNotOptimize(html);
+    }
+}
+BENCHMARK(concordance_query_bm)->Unit(benchmark::kMillisecond)->Name("Positional index, contexts from the index file");
+
+static void radix_tree_bm(benchmark::State& state) {
+    auto params = Params{};
+    params.prefix = "pre";
+    for (auto _ : state) {
+        auto html = ribomation::wordcount::radix_tree::run(params);
+        benchmark::DoNotOptimize(html);
+    }
+}
+BENCHMARK(radix_tree_bm)->Unit(benchmark::kMillisecond)->Name("Adaptive radix tree, prefix top-K");
+
+
+// --- counter backends only: the words are tokenized up front ---
+static auto corpus_text() -> std::string& {
+    static auto text = [] {
+        auto in = std::ifstream{Params{}.filename};
+        return std::string{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+    }();
+    return text;
+}
+
+static auto corpus_words() -> std::vector<std::string_view> const& {
+    static auto words = [] {
+        auto result = std::vector<std::string_view>{};
+        using WordIterator = ribomation::wordcount::mem_map::FoldingWordIterator;
+        for (auto it = WordIterator{corpus_text(), Params{}.min_length}; it != WordIterator{}; ++it) result.push_back(*it);
+        return result;
+    }();
+    return words;
+}
+
+// Counts the bytes handed out, to compare the hash map's footprint with the tree's arena.
+static size_t hash_map_bytes = 0;
+
+template<typename T>
+struct CountingAllocator {
+    using value_type = T;
+    CountingAllocator() = default;
+    template<typename U> CountingAllocator(CountingAllocator<U> const&) {}
+
+    auto allocate(size_t n) -> T* {
+        hash_map_bytes += n * sizeof(T);
+        return std::allocator<T>{}.allocate(n);
+    }
+    void deallocate(T* p, size_t n) {
+        hash_map_bytes -= n * sizeof(T);
+        std::allocator<T>{}.deallocate(p, n);
+    }
+    template<typename U> auto operator==(CountingAllocator<U> const&) const -> bool { return true; }
+};
+
+static void hash_map_insert_bm(benchmark::State& state) {
+    auto const& words = corpus_words();
+    using Map = std::unordered_map<std::string_view, unsigned, std::hash<std::string_view>, std::equal_to<>,
+                                   CountingAllocator<std::pair<std::string_view const, unsigned>>>;
+    for (auto _ : state) {
+        auto freqs = Map{};
+        for (auto word: words) ++freqs[word];
+        state.counters["bytes/word"] = static_cast<double>(hash_map_bytes) / freqs.size();
+        benchmark::DoNotOptimize(freqs);
+    }
+    state.SetItemsProcessed(state.iterations() * words.size());
+}
+BENCHMARK(hash_map_insert_bm)->Unit(benchmark::kMillisecond)->Name("Insert: unordered_map<string_view,unsigned>");
+
+static void radix_tree_insert_bm(benchmark::State& state) {
+    auto const& words = corpus_words();
+    for (auto _ : state) {
+        auto tree = ribomation::wordcount::AdaptiveRadixTree{};
+        for (auto word: words) tree.insert(word);
+        state.counters["bytes/word"] = static_cast<double>(tree.bytes()) / tree.size();
+        benchmark::DoNotOptimize(tree);
+    }
+    state.SetItemsProcessed(state.iterations() * words.size());
+}
+BENCHMARK(radix_tree_insert_bm)->Unit(benchmark::kMillisecond)->Name("Insert: adaptive radix tree");
+
+static void compact_table_insert_bm(benchmark::State& state) {
+    auto const& words = corpus_words();
+    for (auto _ : state) {
+        auto table = ribomation::wordcount::CompactWordTable{corpus_text(), 0};
+        for (auto word: words) table.add(word);
+        state.counters["bytes/word"] = static_cast<double>(table.bytes()) / table.size();
+        benchmark::DoNotOptimize(table);
+    }
+    state.SetItemsProcessed(state.iterations() * words.size());
+}
+BENCHMARK(compact_table_insert_bm)->Unit(benchmark::kMillisecond)->Name("Insert: compact 8-byte entries");
+
 BENCHMARK_MAIN();
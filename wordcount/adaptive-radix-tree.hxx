@@ -0,0 +1,413 @@
+#pragma once
+#include <string_view>
+#include <array>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <utility>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ribomation::wordcount {
+
+    // Bump allocator for tree nodes, which are trivially destructible and released all at once.
+    class Arena {
+        static constexpr auto chunk_size = 256UL * 1024;
+        std::vector<std::unique_ptr<std::byte[]>> chunks{};
+        size_t used = chunk_size;
+        size_t allocated = 0;
+
+    public:
+        template<typename T>
+        auto make() -> T* {
+            static_assert(std::is_trivially_destructible_v<T>);
+            static_assert(alignof(T) <= alignof(void*));
+            auto const size = (sizeof(T) + alignof(void*) - 1) & ~(alignof(void*) - 1);
+            if (used + size > chunk_size) {
+                chunks.push_back(std::make_unique<std::byte[]>(chunk_size));
+                used = 0;
+            }
+            auto storage = chunks.back().get() + used;
+            used += size;
+            allocated += size;
+            return new(storage) T{};
+        }
+
+        [[nodiscard]] auto bytes() const -> size_t { return allocated; }
+    };
+
+    // Word counter as an adaptive radix tree (Leis et al., ICDE 2013): inner nodes grow from 4 to 16, 48
+    // and 256 children as needed, and chains of single-child nodes are collapsed into a node prefix.
+    // Keys are views into a buffer that must outlive the tree, e.g. a memory-mapped file.
+    // Iteration is in lexical (byte) order, so prefix queries and sorted output need no extra sort.
+    class AdaptiveRadixTree {
+        enum class Type : uint8_t { leaf, node4, node16, node48, node256 };
+
+        struct Node {
+            Type type;
+        };
+
+        struct Leaf : Node {
+            unsigned count;
+            std::string_view word;
+        };
+
+        // The prefix is the collapsed path below the byte leading here, the word the one ending at this node.
+        // Both are kept as pointer and 32-bit length, so the common header is 32 bytes.
+        struct Inner : Node {
+            uint16_t num_children;
+            unsigned count;
+            uint32_t prefix_length, word_length;
+            char const* prefix_data;
+            char const* word_data;
+
+            [[nodiscard]] auto prefix() const -> std::string_view { return {prefix_data, prefix_length}; }
+
+            [[nodiscard]] auto word() const -> std::string_view { return {word_data, word_length}; }
+
+            void set_prefix(std::string_view p) {
+                prefix_data = p.data();
+                prefix_length = static_cast<uint32_t>(p.size());
+            }
+
+            void set_word(std::string_view w) {
+                word_data = w.data();
+                word_length = static_cast<uint32_t>(w.size());
+            }
+        };
+
+        struct Node4 : Inner {
+            uint8_t keys[4];
+            Node* children[4];
+        };
+
+        struct Node16 : Inner {
+            uint8_t keys[16];
+            Node* children[16];
+        };
+
+        struct Node48 : Inner {
+            uint8_t child_index[256];   // slot + 1, zero when absent
+            Node* children[48];
+        };
+
+        struct Node256 : Inner {
+            Node* children[256];
+        };
+
+        Arena arena{};
+        std::array<void*, 5> spare{};   // outgrown nodes per type, linked through their first bytes
+        Node* root = nullptr;
+        size_t num_words = 0;
+
+        auto new_leaf(std::string_view word) -> Node* {
+            auto leaf = arena.make<Leaf>();
+            leaf->type = Type::leaf;
+            leaf->count = 1;
+            leaf->word = word;
+            ++num_words;
+            return leaf;
+        }
+
+        template<typename T>
+        auto allocate(Type type) -> T* {
+            auto& head = spare[static_cast<size_t>(type)];
+            if (head == nullptr) return arena.make<T>();
+            auto block = head;
+            std::memcpy(&head, block, sizeof(void*));
+            return new(block) T{};
+        }
+
+        void release(Node* node) {
+            auto& head = spare[static_cast<size_t>(node->type)];
+            std::memcpy(static_cast<void*>(node), &head, sizeof(void*));
+            head = node;
+        }
+
+        auto new_node4(std::string_view prefix) -> Node4* {
+            auto node = allocate<Node4>(Type::node4);
+            node->type = Type::node4;
+            node->set_prefix(prefix);
+            return node;
+        }
+
+        template<typename Big, typename Small>
+        auto grown(Small* small, Type type) -> Big* {
+            auto big = allocate<Big>(type);
+            static_cast<Inner&>(*big) = static_cast<Inner const&>(*small);
+            big->type = type;
+            return big;
+        }
+
+        static auto find_child(Inner* node, uint8_t byte) -> Node** {
+            switch (node->type) {
+                case Type::node4: {
+                    auto n = static_cast<Node4*>(node);
+                    for (auto k = 0U; k < n->num_children; ++k) if (n->keys[k] == byte) return &n->children[k];
+                    return nullptr;
+                }
+                case Type::node16: {
+                    auto n = static_cast<Node16*>(node);
+                    auto last = n->keys + n->num_children;
+                    auto it = std::lower_bound(n->keys, last, byte);
+                    return it != last && *it == byte ? &n->children[it - n->keys] : nullptr;
+                }
+                case Type::node48: {
+                    auto n = static_cast<Node48*>(node);
+                    return n->child_index[byte] ? &n->children[n->child_index[byte] - 1] : nullptr;
+                }
+                case Type::node256: {
+                    auto n = static_cast<Node256*>(node);
+                    return n->children[byte] ? &n->children[byte] : nullptr;
+                }
+                default:
+                    return nullptr;
+            }
+        }
+
+        template<typename SortedNode>
+        static void insert_sorted(SortedNode* n, uint8_t byte, Node* child) {
+            auto pos = static_cast<unsigned>(std::lower_bound(n->keys, n->keys + n->num_children, byte) - n->keys);
+            std::memmove(n->keys + pos + 1, n->keys + pos, n->num_children - pos);
+            std::memmove(n->children + pos + 1, n->children + pos, (n->num_children - pos) * sizeof(Node*));
+            n->keys[pos] = byte;
+            n->children[pos] = child;
+            ++n->num_children;
+        }
+
+        // Adds child under byte to the inner node in ref, replacing it with a bigger node when full.
+        void add_child(Node*& ref, uint8_t byte, Node* child) {
+            auto node = static_cast<Inner*>(ref);
+            switch (node->type) {
+                case Type::node4: {
+                    auto n = static_cast<Node4*>(node);
+                    if (n->num_children < 4) return insert_sorted(n, byte, child);
+                    auto big = grown<Node16>(n, Type::node16);
+                    std::copy_n(n->keys, 4, big->keys);
+                    std::copy_n(n->children, 4, big->children);
+                    ref = big;
+                    release(n);
+                    return insert_sorted(big, byte, child);
+                }
+                case Type::node16: {
+                    auto n = static_cast<Node16*>(node);
+                    if (n->num_children < 16) return insert_sorted(n, byte, child);
+                    auto big = grown<Node48>(n, Type::node48);
+                    for (auto k = 0U; k < 16; ++k) {
+                        big->children[k] = n->children[k];
+                        big->child_index[n->keys[k]] = static_cast<uint8_t>(k + 1);
+                    }
+                    ref = big;
+                    release(n);
+                    return add_child(ref, byte, child);
+                }
+                case Type::node48: {
+                    auto n = static_cast<Node48*>(node);
+                    if (n->num_children < 48) {
+                        n->children[n->num_children] = child;
+                        n->child_index[byte] = static_cast<uint8_t>(++n->num_children);
+                        return;
+                    }
+                    auto big = grown<Node256>(n, Type::node256);
+                    for (auto b = 0U; b < 256; ++b) {
+                        if (n->child_index[b]) big->children[b] = n->children[n->child_index[b] - 1];
+                    }
+                    ref = big;
+                    release(n);
+                    return add_child(ref, byte, child);
+                }
+                case Type::node256: {
+                    auto n = static_cast<Node256*>(node);
+                    n->children[byte] = child;
+                    ++n->num_children;
+                    return;
+                }
+                default:
+                    return;
+            }
+        }
+
+        static auto common_prefix(std::string_view a, std::string_view b) -> size_t {
+            auto [ia, ib] = std::mismatch(a.begin(), a.end(), b.begin(), b.end());
+            return static_cast<size_t>(ia - a.begin());
+        }
+
+        template<typename Consumer>
+        static void visit(Node const* node, Consumer& consume) {
+            if (node->type == Type::leaf) {
+                auto leaf = static_cast<Leaf const*>(node);
+                consume(leaf->word, leaf->count);
+                return;
+            }
+
+            auto inner = static_cast<Inner const*>(node);
+            if (inner->count > 0) consume(inner->word(), inner->count);
+            switch (node->type) {
+                case Type::node4: {
+                    auto n = static_cast<Node4 const*>(node);
+                    for (auto k = 0U; k < n->num_children; ++k) visit(n->children[k], consume);
+                    return;
+                }
+                case Type::node16: {
+                    auto n = static_cast<Node16 const*>(node);
+                    for (auto k = 0U; k < n->num_children; ++k) visit(n->children[k], consume);
+                    return;
+                }
+                case Type::node48: {
+                    auto n = static_cast<Node48 const*>(node);
+                    for (auto b = 0U; b < 256; ++b) if (n->child_index[b]) visit(n->children[n->child_index[b] - 1], consume);
+                    return;
+                }
+                case Type::node256: {
+                    auto n = static_cast<Node256 const*>(node);
+                    for (auto b = 0U; b < 256; ++b) if (n->children[b]) visit(n->children[b], consume);
+                    return;
+                }
+                default:
+                    return;
+            }
+        }
+
+    public:
+        void insert(std::string_view key) {
+            auto ref = &root;
+            auto depth = 0UL;
+            while (true) {
+                auto node = *ref;
+                if (node == nullptr) {
+                    *ref = new_leaf(key);
+                    return;
+                }
+
+                if (node->type == Type::leaf) {
+                    auto leaf = static_cast<Leaf*>(node);
+                    if (leaf->word == key) {
+                        ++leaf->count;
+                        return;
+                    }
+                    auto p = common_prefix(leaf->word.substr(depth), key.substr(depth));
+                    auto split = new_node4(key.substr(depth, p));
+                    auto end = depth + p;
+                    Node* split_ref = split;
+                    if (leaf->word.size() == end) {
+                        split->count = leaf->count;
+                        split->set_word(leaf->word);
+                    } else {
+                        add_child(split_ref, static_cast<uint8_t>(leaf->word[end]), leaf);
+                    }
+                    if (key.size() == end) {
+                        split->count += 1;
+                        split->set_word(key);
+                        ++num_words;
+                    } else {
+                        add_child(split_ref, static_cast<uint8_t>(key[end]), new_leaf(key));
+                    }
+                    *ref = split_ref;
+                    return;
+                }
+
+                auto inner = static_cast<Inner*>(node);
+                auto p = common_prefix(inner->prefix(), key.substr(depth));
+                if (p < inner->prefix().size()) {
+                    auto split = new_node4(inner->prefix().substr(0, p));
+                    Node* split_ref = split;
+                    auto byte = static_cast<uint8_t>(inner->prefix()[p]);
+                    inner->set_prefix(inner->prefix().substr(p + 1));
+                    add_child(split_ref, byte, inner);
+                    if (key.size() == depth + p) {
+                        split->count = 1;
+                        split->set_word(key);
+                        ++num_words;
+                    } else {
+                        add_child(split_ref, static_cast<uint8_t>(key[depth + p]), new_leaf(key));
+                    }
+                    *ref = split_ref;
+                    return;
+                }
+
+                depth += inner->prefix().size();
+                if (key.size() == depth) {
+                    if (inner->count++ == 0) {
+                        inner->set_word(key);
+                        ++num_words;
+                    }
+                    return;
+                }
+
+                auto byte = static_cast<uint8_t>(key[depth]);
+                if (auto child = find_child(inner, byte)) {
+                    ref = child;
+                    depth += 1;
+                    continue;
+                }
+                add_child(*ref, byte, new_leaf(key));
+                return;
+            }
+        }
+
+        [[nodiscard]] auto size() const -> size_t { return num_words; }
+
+        [[nodiscard]] auto bytes() const -> size_t { return arena.bytes(); }
+
+        // Calls consume(word, count) for every word in lexical order.
+        template<typename Consumer>
+        void for_each(Consumer&& consume) const {
+            if (root) visit(root, consume);
+        }
+
+        // Calls consume(word, count) for every word starting with prefix, in lexical order.
+        template<typename Consumer>
+        void for_each_prefixed(std::string_view prefix, Consumer&& consume) const {
+            auto node = static_cast<Node const*>(root);
+            auto depth = 0UL;
+            while (node) {
+                if (node->type == Type::leaf) {
+                    auto leaf = static_cast<Leaf const*>(node);
+                    if (leaf->word.starts_with(prefix)) consume(leaf->word, leaf->count);
+                    return;
+                }
+
+                auto inner = static_cast<Inner const*>(node);
+                auto rest = prefix.substr(depth);
+                auto m = std::min(rest.size(), inner->prefix().size());
+                if (inner->prefix().substr(0, m) != rest.substr(0, m)) return;
+                if (rest.size() <= inner->prefix().size()) {
+                    visit(node, consume);
+                    return;
+                }
+
+                depth += inner->prefix().size();
+                auto child = find_child(const_cast<Inner*>(inner), static_cast<uint8_t>(prefix[depth]));
+                node = child ? *child : nullptr;
+                depth += 1;
+            }
+        }
+
+        // The K most frequent words starting with prefix, most frequent first, ties in lexical order.
+        [[nodiscard]] auto top(std::string_view prefix, unsigned K) const -> std::vector<std::pair<std::string_view, unsigned>> {
+            using WordFreq = std::pair<std::string_view, unsigned>;
+            if (K == 0) return {};
+
+            // the heap keeps its lowest ranked word in front, so a word is admitted iff it ranks before that one
+            auto ranks_before = [](WordFreq const& a, WordFreq const& b) {
+                return a.second != b.second ? a.second > b.second : a.first < b.first;
+            };
+            auto heap = std::vector<WordFreq>{};
+            heap.reserve(K + 1);
+            for_each_prefixed(prefix, [&](std::string_view word, unsigned count) {
+                if (heap.size() == K && not ranks_before(WordFreq{word, count}, heap.front())) return;
+                heap.emplace_back(word, count);
+                std::ranges::push_heap(heap, ranks_before);
+                if (heap.size() > K) {
+                    std::ranges::pop_heap(heap, ranks_before);
+                    heap.pop_back();
+                }
+            });
+            std::ranges::sort_heap(heap, ranks_before);
+            return heap;
+        }
+    };
+
+}
@@ -12,78 +12,14 @@
 #include <random>
 #include <cctype>
 #include "params.hxx"
+#include "word-cloud.hxx"
+#include "word-iterator.hxx"
 
 
 namespace ribomation::wordcount::baseline {
 
-    class WordIterator {
-    public:
-        using iterator_category = std::input_iterator_tag;
-        using value_type = std::string;
-        using reference = const std::string&;
-        using pointer = const std::string *;
-        using difference_type = std::ptrdiff_t;
-
-        WordIterator() = default;
-
-        explicit WordIterator(std::istream& is) : input{&is} {
-            read_next();
-        }
-
-        reference operator*() const { return current_word; }
-        pointer operator->() const { return &current_word; }
-
-        WordIterator& operator++() {
-            read_next();
-            return *this;
-        }
-
-        WordIterator operator++(int) {
-            auto tmp = *this;
-            ++(*this);
-            return tmp;
-        }
-
-        friend bool operator==(WordIterator const& a, WordIterator const& b) {
-            return a.input == b.input && a.at_eof == b.at_eof;
-        }
-
-        friend bool operator!=(WordIterator const& a, WordIterator const& b) {
-            return !(a == b);
-        }
-
-    private:
-        std::istream* input{nullptr};
-        std::string current_word{};
-        bool at_eof{true};
-
-        void read_next() {
-            if (input == nullptr) {
-                at_eof = true;
-                return;
-            }
-
-            current_word.clear();
-            for (char ch; input->get(ch) && not is_letter(ch);) {}
-            if (input->gcount()) input->unget();
-
-            if (current_word.empty() && input->eof()) {
-                at_eof = true;
-                input = nullptr;
-                return;
-            }
-
-            for (char ch; input->get(ch) && is_letter(ch);) {
-                current_word.push_back(ch);
-            }
-            at_eof = false;
-        }
-
-        static bool is_letter(char c) {
-            auto ch = static_cast<unsigned char>(c);
-            return std::isalpha(ch) || ch == '\'';
-        }
-    };
+    // Words of --token-chars as they are read, the pipeline below filters and lower-cases them
+    using WordIterator = wordcount::WordIterator<std::istream, policy::Configured, policy::PreFolded, policy::KeepAll>;
 
     namespace r = std::ranges;
     namespace v = std::ranges::views;
@@ -148,7 +84,7 @@ namespace ribomation::wordcount::baseline {
                 : params(params_), scale(scale_), min_freq(min_freq_), R(R_) {}
 
             auto operator()(WordFreq& wf) -> string {
-                auto word = wf.first;
+                auto word = html_escaped(wf.first);
                 auto freq = wf.second;
                 auto size = static_cast<unsigned>((freq - min_freq) * scale + params.min_font);
                 auto colr = color();
@@ -173,7 +109,7 @@ namespace ribomation::wordcount::baseline {
                     <title>Word Frequencies</title>
                 </head>
             <body>)";
-        html << std::format("<h1>The {} most frequent words in {}</h1>", params.max_words, params.filename.string());
+        html << std::format("<h1>The {} most frequent words in {}</h1>", params.max_words, html_escaped(params.filename.string()));
         for (string const& tag: tags) html << tag << "\n";
         html << "</body></html>\n";
 
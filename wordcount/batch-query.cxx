@@ -0,0 +1,193 @@
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <fstream>
+#include <print>
+#include <stdexcept>
+#include <vector>
+#include <ranges>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <exception>
+
+#include "params.hxx"
+#include "word-cloud.hxx"
+#include "statistics.hxx"
+#include "hyperloglog.hxx"
+#include "mem-map-file.hxx"
+#include "compact-table.hxx"
+#include "kernels.hxx"
+
+
+namespace ribomation::wordcount::batch {
+    namespace fs = std::filesystem;
+    namespace r = std::ranges;
+    using namespace std::string_literals;
+    using std::string;
+    using std::string_view;
+    using mem_map::MemoryMappedFile;
+    using mem_map::WordIterator;
+    using WordFreq = std::pair<string_view, unsigned>;
+
+    // Words of this length or longer share the last bucket.
+    constexpr auto max_bucket = 64U;
+
+    auto by_freq_desc(WordFreq const& a, WordFreq const& b) -> bool {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    }
+
+    // All words counted once, without a length filter, then split into one bucket per word length.
+    // Each bucket keeps only its top max_words (most frequent first), which suffices for any --min,
+    // except the last one, which is kept whole as it mixes lengths.
+    class LengthBuckets {
+        std::vector<std::vector<WordFreq>> buckets = std::vector<std::vector<WordFreq>>(max_bucket + 1);
+
+    public:
+        LengthBuckets(CompactWordTable const& table, unsigned max_words) {
+            table.for_each([this](string_view word, unsigned count) {
+                buckets[std::min<size_t>(word.size(), max_bucket)].emplace_back(word, count);
+            });
+            for (auto length = 1U; length <= max_bucket; ++length) {
+                auto& bucket = buckets[length];
+                auto const N = length < max_bucket ? std::min<size_t>(max_words, bucket.size()) : bucket.size();
+                r::partial_sort(bucket, bucket.begin() + N, by_freq_desc);
+                bucket.resize(N);
+            }
+        }
+
+        // The max_words most frequent words of at least min_length, by a k-way merge of the buckets.
+        [[nodiscard]] auto top(unsigned min_length, unsigned max_words) const -> std::vector<WordFreq> {
+            struct Cursor {
+                WordFreq const* current;
+                WordFreq const* end;
+            };
+            auto by_current = [](Cursor const& a, Cursor const& b) { return by_freq_desc(*b.current, *a.current); };
+
+            auto heap = std::vector<Cursor>{};
+            auto long_words = std::vector<WordFreq>{};
+            for (auto length = std::max(min_length, 1U); length <= max_bucket; ++length) {
+                auto const& bucket = buckets[length];
+                if (not bucket.empty()) heap.push_back(Cursor{bucket.data(), bucket.data() + bucket.size()});
+            }
+            if (min_length > max_bucket) {
+                r::copy_if(buckets[max_bucket], std::back_inserter(long_words),
+                           [min_length](WordFreq const& wf) { return wf.first.size() >= min_length; });
+                if (not long_words.empty()) heap.push_back(Cursor{long_words.data(), long_words.data() + long_words.size()});
+            }
+            r::make_heap(heap, by_current);
+
+            auto result = std::vector<WordFreq>{};
+            result.reserve(max_words);
+            while (result.size() < max_words && not heap.empty()) {
+                r::pop_heap(heap, by_current);
+                auto& cursor = heap.back();
+                result.push_back(*cursor.current);
+                if (++cursor.current == cursor.end) heap.pop_back();
+                else r::push_heap(heap, by_current);
+            }
+            return result;
+        }
+    };
+
+    auto render(Params const& params, std::vector<WordFreq> sortable) -> string {
+        // --- making html span tags ---
+        auto cloud = WordCloud{params};
+        auto html = cloud.head(std::format("The {} most frequent words of at least {} letters in {}",
+                                           params.max_words, params.min_length, params.filename.string()));
+        html += cloud.spans(sortable);
+        html += WordCloud::tail();
+
+        return html;
+    }
+
+    auto output_filename(Params const& query) -> fs::path {
+        return fs::path{"."} / std::format("{}-min{}-max{}.html",
+                                           query.filename.stem().string(), query.min_length, query.max_words);
+    }
+
+    // Answers every (--min-list, --max-list) combination from one count of the file. Each combination is
+    // written to <stem>-min<N>-max<M>.html, rendered in parallel; the returned page links them all.
+    auto run(Params const& params, Statistics& stats) -> string {
+        auto min_lengths = params.min_lengths.empty() ? std::vector{params.min_length} : params.min_lengths;
+        auto max_words_list = params.max_words_list.empty() ? std::vector{params.max_words} : params.max_words_list;
+
+        auto queries = std::vector<Params>{};
+        for (auto min_length: min_lengths) {
+            for (auto max_words: max_words_list) {
+                auto& query = queries.emplace_back(params);
+                query.min_length = min_length;
+                query.max_words = max_words;
+            }
+        }
+
+        // --- loading all words, once ---
+        auto file = MemoryMappedFile{params.filename};
+        stats.estimated_unique_words = estimate_unique_words(file.data(), 1);
+        kernels::fold_to_lower(file.data());
+        file.freeze();
+
+        auto freqs = CompactWordTable{file.data(), stats.estimated_unique_words};
+        auto first = WordIterator{file.data(), 1};
+        auto last = WordIterator{};
+        r::for_each(r::subrange{first, last}, [&freqs](string_view word) {
+            freqs.add(word);
+        });
+        stats.unique_words = freqs.size();
+
+
+        // --- sorting <word,count> pairs, per word length ---
+        auto const buckets = LengthBuckets{freqs, r::max(max_words_list)};
+
+
+        // --- rendering and storing each combination in parallel ---
+        auto next = std::atomic<size_t>{0};
+        auto errors = std::vector<std::exception_ptr>(queries.size());
+        auto worker = [&] {
+            for (auto k = next++; k < queries.size(); k = next++) {
+                try {
+                    auto const& query = queries[k];
+                    auto html = render(query, buckets.top(query.min_length, query.max_words));
+                    auto filename = output_filename(query);
+                    auto out = std::ofstream{filename};
+                    if (not (out << html)) throw std::runtime_error{"cannot write "s + filename.string()};
+                } catch (...) {
+                    errors[k] = std::current_exception();
+                }
+            }
+        };
+        {
+            auto const num_threads = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, queries.size());
+            auto threads = std::vector<std::jthread>{};
+            for (auto k = 0UL; k < num_threads; ++k) threads.emplace_back(worker);
+        }
+        for (auto const& error: errors) {
+            if (error) std::rethrow_exception(error);
+        }
+
+
+        // --- an index page of all combinations ---
+        auto html = string{R"(<!DOCTYPE html>
+            <html lang="en">
+                <head>
+                    <meta charset="UTF-8">
+                    <title>Word Frequencies</title>
+                </head>
+            <body>)"};
+        html += std::format("<h1>{} word clouds of {}</h1>\n<ul>\n", queries.size(), html_escaped(params.filename.string()));
+        for (auto const& query: queries) {
+            auto filename = output_filename(query).filename().string();
+            std::println("written: ./{}", filename);
+            html += std::format(R"(<li><a href="{}">at least {} letters, {} words</a></li>)", html_escaped(filename),
+                                query.min_length, query.max_words) + "\n";
+        }
+        html += "</ul>\n</body></html>\n";
+
+        return html;
+    }
+
+    auto run(Params const& params) -> string {
+        auto stats = Statistics{};
+        return run(params, stats);
+    }
+}
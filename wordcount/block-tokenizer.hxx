@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <span>
+
+#include "word-iterator.hxx"
+
+namespace ribomation::wordcount {
+
+    // Splits a stream arriving in blocks into lower-cased words (--token-chars, at least min_length,
+    // not a modern word). Words are lower-cased in the block, so each view is valid until the block is reused.
+    class BlockTokenizer {
+        unsigned min_length;
+        std::string partial{};
+
+        using Letters = policy::Configured;
+        using Fold = policy::FoldInPlace;
+        using Filter = policy::NotModern;
+
+        template<typename Consumer>
+        void emit(std::string_view word, Consumer& consume) {
+            if (word.size() < min_length || not Filter::keep(word)) return;
+            consume(word);
+        }
+
+    public:
+        explicit BlockTokenizer(unsigned min_length_) : min_length(min_length_) {}
+
+        // A word running up to the end of the block is kept until the next block completes it.
+        template<typename Consumer>
+        void feed(std::span<char> block, Consumer&& consume) {
+            auto pos = block.begin();
+            if (not partial.empty()) {
+                for (; pos != block.end() && Letters::is_letter(*pos); ++pos) partial.push_back(Fold::fold(*pos));
+                if (pos == block.end()) return;
+                emit(partial, consume);
+                partial.clear();
+            }
+
+            while (true) {
+                while (pos != block.end() && not Letters::is_letter(*pos)) ++pos;
+                if (pos == block.end()) return;
+
+                auto start = pos;
+                for (; pos != block.end() && Letters::is_letter(*pos); ++pos) *pos = Fold::fold(*pos);
+                if (pos == block.end()) {
+                    partial.assign(start, pos);
+                    return;
+                }
+                emit(std::string_view{&*start, static_cast<size_t>(pos - start)}, consume);
+            }
+        }
+
+        template<typename Consumer>
+        void finish(Consumer&& consume) {
+            if (not partial.empty()) emit(partial, consume);
+            partial.clear();
+        }
+    };
+
+}
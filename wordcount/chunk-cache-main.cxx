@@ -0,0 +1,24 @@
+#include <string>
+#include <functional>
+#include "params.hxx"
+#include "statistics.hxx"
+
+using namespace std::string_literals;
+using std::string;
+using ribomation::wordcount::Params;
+using ribomation::wordcount::Statistics;
+
+extern void word_count(string const& name, Params const& params, std::function<string(Statistics&)> const& generate_html);
+
+namespace ribomation::wordcount::chunk_cache {
+    extern auto run(Params const& P, Statistics& S) -> std::string;
+}
+
+int main(int argc, char* argv[]) {
+    auto params = Params{};
+    params.parse(argc, argv);
+
+    word_count("Content-defined chunk cache"s, params, [&params](Statistics& stats) {
+        return ribomation::wordcount::chunk_cache::run(params, stats);
+    });
+}
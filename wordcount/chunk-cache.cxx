@@ -0,0 +1,379 @@
+#include <string>
+#include <string_view>
+#include <span>
+#include <filesystem>
+#include <stdexcept>
+#include <array>
+#include <vector>
+#include <deque>
+#include <optional>
+#include <unordered_map>
+#include <ranges>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "params.hxx"
+#include "word-cloud.hxx"
+#include "statistics.hxx"
+#include "mem-map-file.hxx"
+#include "kernels.hxx"
+
+
+namespace ribomation::wordcount::chunk_cache {
+    namespace fs = std::filesystem;
+    namespace r = std::ranges;
+    using namespace std::string_literals;
+    using namespace std::string_view_literals;
+    using std::string;
+    using std::string_view;
+    using std::span;
+    using mem_map::MemoryMappedFile;
+    using mem_map::WordIterator;
+    using WordFreq = std::pair<string_view, unsigned>;
+
+
+    // --- content-defined chunking ---
+    // Chunks are cut where a gear rolling hash (Xia et al., FastCDC) has its top 10 bits clear, tested only right
+    // after a non-letter so no word spans two chunks; with about one non-letter in six bytes of prose that is a cut
+    // every 8 KB. Each step shifts the hash left by one, so bit k depends on the last k + 1 bytes only: the top bits
+    // see a window of 64 bytes, where the low bits would see a handful. An edit therefore only changes the chunks
+    // around it, and all others are found in the cache again.
+    constexpr auto min_chunk = 2UL * 1024;
+    constexpr auto max_chunk = 64UL * 1024;     // from here on, the next non-letter cuts
+    constexpr auto cut_mask = ((1ULL << 10) - 1) << 54;
+
+    constexpr auto gear = [] {
+        auto table = std::array<uint64_t, 256>{};
+        auto x = 0x2545F4914F6CDD1DULL;
+        for (auto& value: table) {
+            auto z = (x += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            value = z ^ (z >> 31);
+        }
+        return table;
+    }();
+
+    auto next_cut(span<char const> text, size_t start) -> size_t {
+        auto h = 0ULL;
+        auto const forced = std::min(start + max_chunk, text.size());
+        for (auto pos = start; pos < text.size(); ++pos) {
+            h = (h << 1) + gear[static_cast<unsigned char>(text[pos])];
+            if (pos + 1 - start < min_chunk || WordIterator::is_letter(text[pos])) continue;
+            if ((h & cut_mask) == 0 || pos + 1 >= forced) return pos + 1;
+        }
+        return text.size();
+    }
+
+
+    // --- 128-bit chunk digests, MurmurHash3 x64_128 ---
+    struct Digest {
+        uint64_t lo = 0, hi = 0;
+
+        friend bool operator==(Digest const&, Digest const&) = default;
+    };
+
+    struct DigestHash {
+        auto operator()(Digest const& d) const -> size_t { return static_cast<size_t>(d.lo); }
+    };
+
+    auto digest_of(span<char const> bytes) -> Digest {
+        constexpr auto c1 = 0x87C37B91114253D5ULL;
+        constexpr auto c2 = 0x4CF5AD432745937FULL;
+        auto fmix = [](uint64_t k) {
+            k ^= k >> 33; k *= 0xFF51AFD7ED558CCDULL;
+            k ^= k >> 33; k *= 0xC4CEB9FE1A85EC53ULL;
+            return k ^ (k >> 33);
+        };
+
+        auto h1 = 0ULL, h2 = 0ULL;
+        auto const num_blocks = bytes.size() / 16;
+        for (auto b = 0UL; b < num_blocks; ++b) {
+            uint64_t k1, k2;
+            std::memcpy(&k1, bytes.data() + b * 16, 8);
+            std::memcpy(&k2, bytes.data() + b * 16 + 8, 8);
+            k1 *= c1; k1 = std::rotl(k1, 31); k1 *= c2; h1 ^= k1;
+            h1 = std::rotl(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52DCE729;
+            k2 *= c2; k2 = std::rotl(k2, 33); k2 *= c1; h2 ^= k2;
+            h2 = std::rotl(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495AB5;
+        }
+
+        auto tail = bytes.subspan(num_blocks * 16);
+        auto k1 = 0ULL, k2 = 0ULL;
+        for (auto k = tail.size(); k > 8; --k) k2 |= static_cast<uint64_t>(static_cast<unsigned char>(tail[k - 1])) << ((k - 9) * 8);
+        for (auto k = std::min<size_t>(tail.size(), 8); k > 0; --k) k1 |= static_cast<uint64_t>(static_cast<unsigned char>(tail[k - 1])) << ((k - 1) * 8);
+        if (tail.size() > 8) { k2 *= c2; k2 = std::rotl(k2, 33); k2 *= c1; h2 ^= k2; }
+        if (not tail.empty()) { k1 *= c1; k1 = std::rotl(k1, 31); k1 *= c2; h1 ^= k1; }
+
+        h1 ^= bytes.size(); h2 ^= bytes.size();
+        h1 += h2; h2 += h1;
+        h1 = fmix(h1); h2 = fmix(h2);
+        h1 += h2; h2 += h1;
+        return Digest{h1, h2};
+    }
+
+
+    // --- the persistent cache ---
+    // An append-only file of "WCCHUNK1" and records {Digest, uint32 num_words, uint32 payload_bytes, payload},
+    // the payload being num_words times {uint32 count, uint32 length, length chars}, host byte order.
+    // The counts are of the lower-cased chunk without a length filter, so they serve any --min.
+    // A record cut short by a crash, or one whose lengths do not add up, ends the valid part, which the next
+    // append overwrites. Once the file would outgrow its bound it is compacted to half of it, keeping the records
+    // of this run first and then the most recently appended ones; the compacted file replaces the old one by rename.
+    class ChunkCache {
+        static constexpr auto magic = "WCCHUNK1"sv;
+        static constexpr auto header_size = sizeof(Digest) + 2 * sizeof(uint32_t);
+        static constexpr auto word_header_size = 2 * sizeof(uint32_t);
+
+        struct Entry {
+            string_view record;     // header and payload
+            bool used = false;      // found or added by this run
+            [[nodiscard]] auto payload() const -> string_view { return record.substr(header_size); }
+        };
+
+        fs::path filename;
+        size_t max_size;
+        int fd = -1;
+        void* storage = nullptr;
+        size_t mapped_size = 0;
+        size_t valid_size = 0;
+        std::unordered_map<Digest, Entry, DigestHash> index{};
+        std::vector<Digest> stored{};       // records of the file, in file order
+        std::deque<string> fresh{};
+        size_t fresh_size = 0;
+
+        // true if the payload holds exactly num_words entries within its bytes
+        static bool well_formed(string_view payload, uint32_t num_words) {
+            for (auto k = 0U; k < num_words; ++k) {
+                if (payload.size() < word_header_size) return false;
+                uint32_t length;
+                std::memcpy(&length, payload.data() + sizeof(uint32_t), sizeof(length));
+                if (payload.size() - word_header_size < length) return false;
+                payload.remove_prefix(word_header_size + length);
+            }
+            return payload.empty();
+        }
+
+        void open_locked() {
+            while (true) {
+                fd = open(filename.string().c_str(), O_RDWR | O_CREAT, 0644);
+                if (fd == -1) throw std::runtime_error{"cannot open "s + filename.string()};
+                if (flock(fd, LOCK_EX) == -1) throw std::runtime_error{"cannot lock "s + filename.string()};
+
+                // a run that compacted while this one waited has renamed a new file into place
+                struct stat opened{}, named{};
+                if (fstat(fd, &opened) == 0 && stat(filename.string().c_str(), &named) == 0
+                    && opened.st_dev == named.st_dev && opened.st_ino == named.st_ino) return;
+                close(fd);
+            }
+        }
+
+        void load() {
+            struct stat st{};
+            if (fstat(fd, &st) == -1) throw std::runtime_error{"cannot stat "s + filename.string()};
+            auto const size = static_cast<size_t>(st.st_size);
+            if (size <= magic.size()) return;
+
+            storage = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            if (storage == MAP_FAILED) throw std::runtime_error{"mmap failed: "s + strerror(errno)};
+            mapped_size = size;
+            auto bytes = string_view{static_cast<char const*>(storage), size};
+            if (not bytes.starts_with(magic)) return;   // not ours, or an old format: start over
+
+            valid_size = magic.size();
+            while (bytes.size() - valid_size >= header_size) {
+                auto digest = Digest{};
+                auto num_words = uint32_t{};
+                auto payload_bytes = uint32_t{};
+                std::memcpy(&digest, bytes.data() + valid_size, sizeof(Digest));
+                std::memcpy(&num_words, bytes.data() + valid_size + sizeof(Digest), sizeof(uint32_t));
+                std::memcpy(&payload_bytes, bytes.data() + valid_size + sizeof(Digest) + sizeof(uint32_t), sizeof(uint32_t));
+                if (bytes.size() - valid_size - header_size < payload_bytes) break;
+                auto record = bytes.substr(valid_size, header_size + payload_bytes);
+                if (not well_formed(record.substr(header_size), num_words)) break;
+                if (index.emplace(digest, Entry{record}).second) stored.push_back(digest);
+                valid_size += record.size();
+            }
+        }
+
+        // Rewrites the file with the records of this run and then the most recent others, up to half the bound.
+        void compact() {
+            auto out = string{magic};
+            auto keep = [&out, budget = max_size / 2](string_view record) {
+                if (out.size() + record.size() <= budget) out += record;
+            };
+            for (auto const& record: fresh) keep(record);
+            for (auto const& digest: stored) {
+                if (auto const& entry = index.at(digest); entry.used) keep(entry.record);
+            }
+            for (auto const& digest: stored | std::views::reverse) {
+                if (auto const& entry = index.at(digest); not entry.used) keep(entry.record);
+            }
+
+            auto const temporary = fs::path{filename.string() + ".tmp"s};
+            struct File {
+                int fd;
+                ~File() { close(fd); }
+            } compacted{open(temporary.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)};
+            if (compacted.fd == -1) throw std::runtime_error{"cannot open "s + temporary.string()};
+            write_at(compacted.fd, temporary, out, 0);
+            fs::rename(temporary, filename);
+        }
+
+        static void write_at(int out_fd, fs::path const& name, string_view bytes, size_t offset) {
+            for (auto written = 0UL; written < bytes.size();) {
+                auto n = pwrite(out_fd, bytes.data() + written, bytes.size() - written, static_cast<off_t>(offset + written));
+                if (n == -1 && errno == EINTR) continue;
+                if (n == -1) throw std::runtime_error{"cannot write "s + name.string() + ": "s + strerror(errno)};
+                written += static_cast<size_t>(n);
+            }
+        }
+
+    public:
+        // Locks the cache file for the lifetime of the object, concurrent runs take turns.
+        // The counts depend on the token chars, a non-default set gets a file of its own.
+        ChunkCache(fs::path const& dir, TokenClass const& tokens, size_t max_size_)
+            : filename(dir / (tokens.fingerprint() == TokenClass{default_token_chars}.fingerprint()
+                                  ? "chunks-v1.bin"s
+                                  : std::format("chunks-v1-{:016x}.bin", tokens.fingerprint()))),
+              max_size(max_size_) {
+            fs::create_directories(dir);
+            open_locked();
+            load();
+        }
+
+        ~ChunkCache() {
+            if (mapped_size > 0) munmap(storage, mapped_size);
+            close(fd);
+        }
+
+        ChunkCache(ChunkCache const&) = delete;
+        ChunkCache& operator=(ChunkCache const&) = delete;
+
+        // The payload of a chunk seen before, which then survives the next compaction.
+        [[nodiscard]] auto find(Digest const& digest) -> std::optional<string_view> {
+            auto it = index.find(digest);
+            if (it == index.end()) return std::nullopt;
+            it->second.used = true;
+            return it->second.payload();
+        }
+
+        // Adds the counts of a new chunk, they are written to the file by persist().
+        template<typename Counts>
+        void add(Digest const& digest, Counts const& counts) {
+            auto& record = fresh.emplace_back(header_size, '\0');
+            for (auto const& [word, count]: counts) {
+                auto const c = static_cast<uint32_t>(count);
+                auto const length = static_cast<uint32_t>(word.size());
+                record.append(reinterpret_cast<char const*>(&c), sizeof(c));
+                record.append(reinterpret_cast<char const*>(&length), sizeof(length));
+                record.append(word);
+            }
+            auto const num_words = static_cast<uint32_t>(counts.size());
+            auto const payload_bytes = static_cast<uint32_t>(record.size() - header_size);
+            std::memcpy(record.data(), &digest, sizeof(Digest));
+            std::memcpy(record.data() + sizeof(Digest), &num_words, sizeof(uint32_t));
+            std::memcpy(record.data() + sizeof(Digest) + sizeof(uint32_t), &payload_bytes, sizeof(uint32_t));
+            index.emplace(digest, Entry{record, true});
+            fresh_size += record.size();
+        }
+
+        // Appends the new records after the valid part of the file, or compacts it if it would outgrow its bound.
+        void persist() {
+            if (fresh.empty()) return;
+            if (std::max(valid_size, magic.size()) + fresh_size > max_size) return compact();
+
+            auto out = string{};
+            if (valid_size == 0) out += magic;
+            for (auto const& record: fresh) out += record;
+
+            if (ftruncate(fd, static_cast<off_t>(valid_size)) == -1)
+                throw std::runtime_error{"cannot truncate "s + filename.string()};
+            write_at(fd, filename, out, valid_size);
+        }
+
+        // A payload from find() holds well-formed entries; a length past its end is a broken invariant.
+        template<typename Consumer>
+        static void for_each_word(string_view payload, Consumer&& consume) {
+            while (not payload.empty()) {
+                uint32_t count, length;
+                if (payload.size() < word_header_size) throw std::runtime_error{"corrupt chunk cache record"};
+                std::memcpy(&count, payload.data(), sizeof(count));
+                std::memcpy(&length, payload.data() + sizeof(count), sizeof(length));
+                if (payload.size() - word_header_size < length) throw std::runtime_error{"corrupt chunk cache record"};
+                consume(payload.substr(word_header_size, length), count);
+                payload.remove_prefix(word_header_size + length);
+            }
+        }
+    };
+
+
+    auto run(Params const& params, Statistics& stats) -> string {
+        // --- loading words, chunk by chunk, from the cache when seen before ---
+        auto file = MemoryMappedFile{params.filename};
+        kernels::fold_to_lower(file.data());
+        file.freeze();
+
+        auto cache = ChunkCache{params.cache_dir.empty() ? fs::path{".wordcount-cache"} : params.cache_dir,
+                                policy::Configured::active, params.cache_mb * 1024ULL * 1024};
+        auto freqs = std::unordered_map<string_view, unsigned>{};
+        auto chunk_freqs = std::unordered_map<string_view, unsigned>{};
+        auto const min_length = params.min_length;
+        auto add = [&freqs, min_length](string_view word, unsigned count) {
+            if (word.size() >= min_length) freqs[word] += count;
+        };
+
+        auto text = file.data();
+        for (auto start = 0UL; start < text.size();) {
+            auto end = next_cut(text, start);
+            auto chunk = text.subspan(start, end - start);
+            auto digest = digest_of(chunk);
+            ++stats.chunks;
+
+            if (auto payload = cache.find(digest)) {
+                ++stats.cached_chunks;
+                ChunkCache::for_each_word(*payload, add);
+            } else {
+                chunk_freqs.clear();
+                for (auto it = WordIterator{chunk, 1}; it != WordIterator{}; ++it) ++chunk_freqs[*it];
+                for (auto const& [word, count]: chunk_freqs) add(word, count);
+                cache.add(digest, chunk_freqs);
+            }
+            start = end;
+        }
+        cache.persist();
+        stats.unique_words = freqs.size();
+
+
+        // --- sorting <word,count> pairs ---
+        auto sortable = std::vector<WordFreq>{freqs.begin(), freqs.end()};
+        auto by_freq_desc = [](auto const& a, auto const& b) { return a.second > b.second; };
+        auto const N = std::min<unsigned>(params.max_words, sortable.size());
+        r::partial_sort(sortable, sortable.begin() + N, by_freq_desc);
+        sortable.resize(N);
+
+
+        // --- making html span tags ---
+        auto cloud = WordCloud{params};
+        auto html = cloud.head(std::format("The {} most frequent words in {}", params.max_words, params.filename.string()));
+        html += cloud.spans(sortable);
+        html += WordCloud::tail();
+
+        return html;
+    }
+
+    auto run(Params const& params) -> string {
+        auto stats = Statistics{};
+        return run(params, stats);
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <span>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <stdexcept>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+namespace ribomation::wordcount {
+
+    // Word counter whose entries are one 64-bit word each: a 40-bit offset into the text, an 8-bit length and a
+    // 16-bit hash tag, with the counts in a parallel array. About 12 bytes per slot instead of a hash node holding
+    // a string_view, and a probe only touches the text on a tag and length match.
+    // The text must stay alive and unmodified while the table is in use, see MemoryMappedFile::freeze().
+    class CompactWordTable {
+        static constexpr auto offset_bits = 40U;
+        static constexpr auto max_text_size = 1ULL << offset_bits;
+        static constexpr auto max_length = 255U;
+
+        std::string_view text;
+        std::vector<uint64_t> entries;      // zero marks an empty slot, words are never empty
+        std::vector<uint32_t> counts;
+        std::unordered_map<std::string_view, unsigned> long_words{};
+        size_t num_entries = 0;
+
+        static auto slots_for(size_t capacity) -> size_t {
+            return std::bit_ceil(std::max<size_t>(capacity + capacity / 3, 1024));
+        }
+
+        static auto pack(uint64_t offset, size_t length, uint64_t hash) -> uint64_t {
+            return offset | static_cast<uint64_t>(length) << offset_bits | (hash >> 48) << 48;
+        }
+
+        static auto tag_and_length(uint64_t entry) -> uint64_t { return entry >> offset_bits; }
+
+        void grow() {
+            auto old_entries = std::move(entries);
+            auto old_counts = std::move(counts);
+            entries = std::vector<uint64_t>(old_entries.size() * 2);
+            counts = std::vector<uint32_t>(old_counts.size() * 2);
+            auto const mask = entries.size() - 1;
+            for (auto k = 0UL; k < old_entries.size(); ++k) {
+                if (old_entries[k] == 0) continue;
+                auto h = std::hash<std::string_view>{}(word(old_entries[k]));
+                auto slot = static_cast<size_t>(h) & mask;
+                while (entries[slot] != 0) slot = (slot + 1) & mask;
+                entries[slot] = old_entries[k];
+                counts[slot] = old_counts[k];
+            }
+        }
+
+        [[nodiscard]] auto word(uint64_t entry) const -> std::string_view {
+            auto offset = entry & (max_text_size - 1);
+            auto length = (entry >> offset_bits) & 0xFF;
+            return text.substr(offset, length);
+        }
+
+    public:
+        CompactWordTable(std::span<char const> text_, size_t capacity)
+            : text(text_.data(), text_.size()), entries(slots_for(capacity)), counts(entries.size()) {
+            if (text.size() > max_text_size)
+                throw std::length_error{"compact word table: text larger than 1 TB (40-bit offsets)"};
+        }
+
+        // word must be a view into the text given to the constructor
+        void add(std::string_view word) {
+            if (word.size() > max_length) {
+                ++long_words[word];
+                return;
+            }
+
+            auto const h = std::hash<std::string_view>{}(word);
+            auto const probe = tag_and_length(pack(0, word.size(), h));
+            auto const mask = entries.size() - 1;
+            auto slot = static_cast<size_t>(h) & mask;
+            for (; entries[slot] != 0; slot = (slot + 1) & mask) {
+                auto entry = entries[slot];
+                if (tag_and_length(entry) == probe && std::memcmp(this->word(entry).data(), word.data(), word.size()) == 0) {
+                    ++counts[slot];
+                    return;
+                }
+            }
+
+            entries[slot] = pack(static_cast<uint64_t>(word.data() - text.data()), word.size(), h);
+            counts[slot] = 1;
+            if (++num_entries * 4 > entries.size() * 3) grow();
+        }
+
+        [[nodiscard]] auto size() const -> size_t { return num_entries + long_words.size(); }
+
+        // Bytes held by the slot and count arrays, the overflow map for words above 255 chars is not included.
+        [[nodiscard]] auto bytes() const -> size_t {
+            return entries.size() * sizeof(uint64_t) + counts.size() * sizeof(uint32_t);
+        }
+
+        // Calls consume(word, count) for every word, in no particular order.
+        template<typename Consumer>
+        void for_each(Consumer&& consume) const {
+            for (auto k = 0UL; k < entries.size(); ++k) {
+                if (entries[k] != 0) consume(word(entries[k]), counts[k]);
+            }
+            for (auto const& [w, count]: long_words) consume(w, count);
+        }
+    };
+
+}
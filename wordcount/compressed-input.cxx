@@ -0,0 +1,393 @@
+#include <string>
+#include <string_view>
+#include <span>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <ranges>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <memory>
+
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#ifdef WORDCOUNT_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef WORDCOUNT_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "params.hxx"
+#include "word-cloud.hxx"
+#include "statistics.hxx"
+#include "block-tokenizer.hxx"
+
+
+namespace ribomation::wordcount::compressed {
+    namespace fs = std::filesystem;
+    namespace r = std::ranges;
+    using namespace std::string_literals;
+    using std::string;
+    using std::string_view;
+    using std::span;
+    using Block = std::vector<char>;
+    using WordFreq = std::pair<string_view, unsigned>;
+
+    constexpr auto block_size = 1024UL * 1024;
+    constexpr auto blocks_in_flight = 8UL;
+
+
+    // The compressed input, a regular file mapped read-only, or a pipe or device such as /dev/stdin read up front.
+    class CompressedFile {
+        void* storage = nullptr;
+        size_t size = 0;
+        std::vector<unsigned char> buffer{};
+
+        void read_stream(int fd) {
+            buffer.resize(block_size);
+            while (true) {
+                if (size == buffer.size()) buffer.resize(2 * buffer.size());
+                auto n = read(fd, buffer.data() + size, buffer.size() - size);
+                if (n == 0) break;
+                if (n == -1) {
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error{"read failed: "s + strerror(errno)};
+                }
+                size += static_cast<size_t>(n);
+            }
+            buffer.resize(size);
+        }
+
+    public:
+        explicit CompressedFile(const fs::path& filename) {
+            const auto fd = open(filename.string().c_str(), O_RDONLY);
+            if (fd == -1) throw std::invalid_argument{"cannot open "s + filename.string()};
+
+            auto ec = std::error_code{};
+            if (not fs::is_regular_file(filename, ec)) {
+                struct CloseOnExit {
+                    int fd;
+                    ~CloseOnExit() { close(fd); }
+                } close_on_exit{fd};
+                read_stream(fd);
+                return;
+            }
+
+            size = fs::file_size(filename);
+            storage = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (storage == MAP_FAILED) throw std::runtime_error{"mmap failed: "s + strerror(errno)};
+            madvise(storage, size, MADV_SEQUENTIAL);
+        }
+
+        ~CompressedFile() {
+            if (storage != nullptr) munmap(storage, size);
+        }
+
+        [[nodiscard]] auto data() const -> span<unsigned char const> {
+            if (storage == nullptr) return span{buffer.data(), size};
+            return span{static_cast<unsigned char const*>(storage), size};
+        }
+
+        CompressedFile(CompressedFile const&) = delete;
+        CompressedFile& operator=(CompressedFile const&) = delete;
+    };
+
+    // Bounded hand-over of decompressed blocks, in sequence order, from the decompressing
+    // thread(s) to the tokenizer. Consumed blocks are recycled, so steady state allocates nothing.
+    class BlockChannel {
+        std::mutex lock{};
+        std::condition_variable changed{};
+        std::map<size_t, Block> ready{};
+        std::vector<Block> pool{};
+        size_t next = 0;
+        size_t num_blocks = std::numeric_limits<size_t>::max();
+        bool cancelled = false;
+        std::exception_ptr error{};
+
+    public:
+        auto acquire() -> Block {
+            auto guard = std::lock_guard{lock};
+            if (pool.empty()) return Block{};
+            auto block = std::move(pool.back());
+            pool.pop_back();
+            block.clear();
+            return block;
+        }
+
+        // Blocks until sequence number seq is within the in-flight window; false if the consumer is gone.
+        auto wait_turn(size_t seq) -> bool {
+            auto guard = std::unique_lock{lock};
+            changed.wait(guard, [&] { return cancelled || seq < next + blocks_in_flight; });
+            return not cancelled;
+        }
+
+        void put(size_t seq, Block block) {
+            if (not wait_turn(seq)) return;
+            auto guard = std::lock_guard{lock};
+            ready.emplace(seq, std::move(block));
+            changed.notify_all();
+        }
+
+        void close(size_t num_blocks_) {
+            auto guard = std::lock_guard{lock};
+            num_blocks = num_blocks_;
+            changed.notify_all();
+        }
+
+        void fail(std::exception_ptr error_) {
+            auto guard = std::lock_guard{lock};
+            if (not error) error = error_;
+            changed.notify_all();
+        }
+
+        void cancel() {
+            auto guard = std::lock_guard{lock};
+            cancelled = true;
+            changed.notify_all();
+        }
+
+        auto take(Block& block) -> bool {
+            auto guard = std::unique_lock{lock};
+            changed.wait(guard, [&] { return error || next >= num_blocks || ready.contains(next); });
+            if (error) std::rethrow_exception(error);
+            if (next >= num_blocks) return false;
+
+            auto node = ready.extract(next);
+            block = std::move(node.mapped());
+            ++next;
+            changed.notify_all();
+            return true;
+        }
+
+        void release(Block block) {
+            auto guard = std::lock_guard{lock};
+            pool.push_back(std::move(block));
+        }
+    };
+
+#ifdef WORDCOUNT_HAVE_ZLIB
+    // Inflates one or more concatenated gzip members into consecutive blocks.
+    void inflate_gzip(span<unsigned char const> input, BlockChannel& channel) {
+        auto z = z_stream{};
+        if (inflateInit2(&z, 15 + 32) != Z_OK) throw std::runtime_error{"inflateInit2 failed"s};
+        auto cleanup = std::unique_ptr<z_stream, decltype(&inflateEnd)>{&z, inflateEnd};
+
+        z.next_in = const_cast<Bytef*>(input.data());
+        auto refill = [&] {
+            auto taken = static_cast<size_t>(z.next_in - input.data());
+            if (z.avail_in == 0) z.avail_in = static_cast<uInt>(std::min<size_t>(input.size() - taken, 1U << 30));
+        };
+        auto next_block = [&](Block& block) {
+            block = channel.acquire();
+            block.resize(block_size);
+            z.next_out = reinterpret_cast<Bytef*>(block.data());
+            z.avail_out = static_cast<uInt>(block.size());
+        };
+
+        auto seq = 0UL;
+        auto block = Block{};
+        next_block(block);
+        for (refill();; refill()) {
+            auto rc = inflate(&z, Z_NO_FLUSH);
+            if (rc == Z_STREAM_END) {
+                refill();
+                if (z.avail_in == 0) break;
+                inflateReset(&z);
+            } else if (rc == Z_BUF_ERROR) {
+                throw std::runtime_error{"truncated gzip input"s};
+            } else if (rc != Z_OK) {
+                throw std::runtime_error{"corrupt gzip input: "s + (z.msg ? z.msg : "")};
+            }
+
+            if (z.avail_out == 0) {
+                channel.put(seq++, std::move(block));
+                next_block(block);
+            }
+        }
+        block.resize(block.size() - z.avail_out);
+        channel.put(seq++, std::move(block));
+        channel.close(seq);
+    }
+#endif
+
+#ifdef WORDCOUNT_HAVE_ZSTD
+    using ZstdContext = std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)>;
+
+    auto zstd_frames(span<unsigned char const> input) -> std::vector<span<unsigned char const>> {
+        auto frames = std::vector<span<unsigned char const>>{};
+        for (auto offset = 0UL; offset < input.size();) {
+            auto size = ZSTD_findFrameCompressedSize(input.data() + offset, input.size() - offset);
+            if (ZSTD_isError(size)) throw std::runtime_error{"corrupt zstd input: "s + ZSTD_getErrorName(size)};
+            frames.push_back(input.subspan(offset, size));
+            offset += size;
+        }
+        return frames;
+    }
+
+    // Decompresses into block, starting at its current end, until either the block has grown by
+    // block_size or the input is complete. Returns true when the input is complete.
+    auto zstd_stream(ZSTD_DCtx* ctx, ZSTD_inBuffer& in, Block& block) -> bool {
+        auto used = block.size();
+        block.resize(used + block_size);
+        auto out = ZSTD_outBuffer{block.data() + used, block_size, 0};
+        auto complete = false;
+        while (out.pos < out.size) {
+            auto in_before = in.pos, out_before = out.pos;
+            auto rc = ZSTD_decompressStream(ctx, &out, &in);
+            if (ZSTD_isError(rc)) throw std::runtime_error{"corrupt zstd input: "s + ZSTD_getErrorName(rc)};
+            if (rc == 0 && in.pos == in.size) {
+                complete = true;
+                break;
+            }
+            if (in.pos == in_before && out.pos == out_before) throw std::runtime_error{"truncated zstd input"s};
+        }
+        block.resize(used + out.pos);
+        return complete;
+    }
+
+    // A single frame is streamed into consecutive blocks.
+    void decompress_zstd(span<unsigned char const> input, BlockChannel& channel) {
+        auto ctx = ZstdContext{ZSTD_createDCtx(), ZSTD_freeDCtx};
+        auto in = ZSTD_inBuffer{input.data(), input.size(), 0};
+        auto seq = 0UL;
+        for (auto complete = false; not complete;) {
+            auto block = channel.acquire();
+            complete = zstd_stream(ctx.get(), in, block);
+            channel.put(seq++, std::move(block));
+        }
+        channel.close(seq);
+    }
+
+    // A multi-frame input gets one block per frame, the frames decompressed on a pool of threads.
+    void decompress_zstd_frames(std::vector<span<unsigned char const>> const& frames, BlockChannel& channel) {
+        auto next_frame = std::atomic<size_t>{0};
+        auto worker = [&] {
+            auto ctx = ZstdContext{ZSTD_createDCtx(), ZSTD_freeDCtx};
+            for (auto k = next_frame++; k < frames.size(); k = next_frame++) {
+                if (not channel.wait_turn(k)) return;
+                auto frame = frames[k];
+                auto block = channel.acquire();
+                auto content_size = ZSTD_getFrameContentSize(frame.data(), frame.size());
+                if (content_size == ZSTD_CONTENTSIZE_ERROR) throw std::runtime_error{"corrupt zstd frame"s};
+                if (content_size == ZSTD_CONTENTSIZE_UNKNOWN) {
+                    auto in = ZSTD_inBuffer{frame.data(), frame.size(), 0};
+                    while (not zstd_stream(ctx.get(), in, block)) {}
+                } else {
+                    block.resize(content_size);
+                    auto rc = ZSTD_decompressDCtx(ctx.get(), block.data(), block.size(), frame.data(), frame.size());
+                    if (ZSTD_isError(rc)) throw std::runtime_error{"corrupt zstd input: "s + ZSTD_getErrorName(rc)};
+                    block.resize(rc);
+                }
+                channel.put(k, std::move(block));
+            }
+        };
+        auto guarded = [&] {
+            try { worker(); } catch (...) { channel.fail(std::current_exception()); }
+        };
+
+        channel.close(frames.size());
+        auto const num_threads = std::clamp<size_t>(std::thread::hardware_concurrency() - 1, 1, blocks_in_flight);
+        auto threads = std::vector<std::jthread>{};
+        for (auto k = 0UL; k < num_threads; ++k) threads.emplace_back(guarded);
+    }
+#endif
+
+    // Starts decompression on its own thread, the blocks arrive through the channel.
+    auto start_decompression(Compression compression, CompressedFile const& file, BlockChannel& channel) -> std::jthread {
+        auto input = file.data();
+        auto producer = [&channel, input, compression] {
+            try {
+                switch (compression) {
+#ifdef WORDCOUNT_HAVE_ZLIB
+                    case Compression::gzip:
+                        inflate_gzip(input, channel);
+                        return;
+#endif
+#ifdef WORDCOUNT_HAVE_ZSTD
+                    case Compression::zstd:
+                        if (auto frames = zstd_frames(input); frames.size() > 1) decompress_zstd_frames(frames, channel);
+                        else decompress_zstd(input, channel);
+                        return;
+#endif
+                    default:
+                        throw std::invalid_argument{"compression format not supported by this build"s};
+                }
+            } catch (...) {
+                channel.fail(std::current_exception());
+            }
+        };
+        return std::jthread{producer};
+    }
+
+    auto run(Params const& params, Statistics& stats) -> string {
+        // --- loading words, while the next blocks are decompressed ---
+        struct Hash {
+            using is_transparent = void;
+            auto operator()(string_view sv) const -> size_t { return std::hash<string_view>{}(sv); }
+        };
+        auto freqs = std::unordered_map<string, unsigned, Hash, std::equal_to<>>{};
+        auto count_word = [&freqs](string_view word) {
+            if (auto it = freqs.find(word); it != freqs.end()) ++it->second;
+            else freqs.emplace(word, 1U);
+        };
+
+        {
+            auto file = CompressedFile{params.filename};
+            auto compression = params.compression;
+            if (compression == Compression::none) compression = Params::compression_of(file.data());
+            if (compression == Compression::none) throw std::invalid_argument{"neither gzip nor zstd input: "s + params.filename.string()};
+            auto channel = BlockChannel{};
+            auto producer = start_decompression(compression, file, channel);
+            struct CancelOnExit {
+                BlockChannel& channel;
+                ~CancelOnExit() { channel.cancel(); }
+            } cancel_on_exit{channel};
+
+            auto tokenizer = BlockTokenizer{params.min_length};
+            for (auto block = Block{}; channel.take(block); channel.release(std::move(block))) {
+                tokenizer.feed(block, count_word);
+            }
+            tokenizer.finish(count_word);
+        }
+        stats.unique_words = freqs.size();
+
+
+        // --- sorting <word,count> pairs ---
+        auto sortable = std::vector<WordFreq>{};
+        sortable.reserve(freqs.size());
+        sortable.insert(sortable.end(), freqs.begin(), freqs.end());
+
+        auto by_freq_desc = [](auto const& a, auto const& b) { return a.second > b.second; };
+        auto const N = std::min<unsigned>(params.max_words, sortable.size());
+        r::partial_sort(sortable, sortable.begin() + N, by_freq_desc);
+        sortable.resize(N);
+
+
+        // --- making html span tags ---
+        auto cloud = WordCloud{params};
+        auto html = cloud.head(std::format("The {} most frequent words in {}", params.max_words, params.filename.string()));
+        html += cloud.spans(sortable);
+        html += WordCloud::tail();
+
+        return html;
+    }
+
+    auto run(Params const& params) -> string {
+        auto stats = Statistics{};
+        return run(params, stats);
+    }
+}
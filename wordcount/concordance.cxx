@@ -0,0 +1,319 @@
+#include <string>
+#include <string_view>
+#include <span>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <tuple>
+#include <optional>
+#include <unordered_map>
+#include <ranges>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "params.hxx"
+#include "word-cloud.hxx"
+#include "statistics.hxx"
+#include "hyperloglog.hxx"
+#include "mem-map-file.hxx"
+#include "kernels.hxx"
+
+
+namespace ribomation::wordcount::concordance {
+    namespace fs = std::filesystem;
+    namespace r = std::ranges;
+    using namespace std::string_literals;
+    using namespace std::string_view_literals;
+    using std::string;
+    using std::string_view;
+    using std::span;
+    using mem_map::MemoryMappedFile;
+    using mem_map::WordIterator;
+    using WordFreq = std::pair<string_view, unsigned>;
+
+
+    // A uint64 gap takes at most this many LEB128 bytes.
+    constexpr auto max_varint_bytes = 10U;
+
+    // Calls consume(offset) for the offsets of LEB128 varint gaps, until it returns false.
+    // Stops at a varint longer than a uint64, which only a damaged list holds.
+    template<typename Consumer>
+    void for_each_offset(span<uint8_t const> deltas, Consumer&& consume) {
+        auto offset = 0ULL;
+        auto delta = 0ULL;
+        auto shift = 0U;
+        for (auto byte: deltas) {
+            if (shift >= 7 * max_varint_bytes) return;
+            delta |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            shift += 7;
+            if (byte & 0x80) continue;
+            offset += delta;
+            if (not consume(offset)) return;
+            delta = 0;
+            shift = 0;
+        }
+    }
+
+    // Byte offsets of one word's occurrences, stored as LEB128 varints of the gap to the previous offset.
+    // Most gaps in a text fit in one or two bytes.
+    class PostingList {
+        std::vector<uint8_t> deltas_{};
+        uint64_t last = 0;
+        unsigned count = 0;
+
+    public:
+        void add(uint64_t offset) {
+            auto delta = offset - last;
+            last = offset;
+            ++count;
+            for (; delta >= 0x80; delta >>= 7) deltas_.push_back(static_cast<uint8_t>(delta | 0x80));
+            deltas_.push_back(static_cast<uint8_t>(delta));
+        }
+
+        [[nodiscard]] auto size() const -> unsigned { return count; }
+
+        [[nodiscard]] auto deltas() const -> span<uint8_t const> { return deltas_; }
+    };
+
+    // A word of the index with its count and posting list, viewed in a Concordance or a loaded IndexFile.
+    struct Postings {
+        string_view word;
+        unsigned count;
+        span<uint8_t const> deltas;
+    };
+
+    // The counted words with their posting lists, words are views into the (case-folded) mapping.
+    class Concordance {
+        std::unordered_map<string_view, PostingList> index{};
+        char const* base;
+
+    public:
+        Concordance(span<char> payload, size_t capacity) : base(payload.data()) {
+            index.reserve(capacity);
+        }
+
+        void add(string_view word) {
+            index[word].add(static_cast<uint64_t>(word.data() - base));
+        }
+
+        [[nodiscard]] auto postings() const -> std::vector<Postings> {
+            auto result = std::vector<Postings>{};
+            result.reserve(index.size());
+            for (auto const& [word, list]: index) result.push_back(Postings{word, list.size(), list.deltas()});
+            return result;
+        }
+    };
+
+    // Up to limit lines of width bytes each side of the occurrences of word, in file order,
+    // cut from an untouched mapping of the input.
+    auto contexts(std::vector<Postings> const& index, span<char const> original, string_view word, unsigned width, unsigned limit)
+        -> std::vector<std::tuple<string_view, string_view, string_view>> {
+        auto lines = std::vector<std::tuple<string_view, string_view, string_view>>{};
+        auto it = r::find(index, word, &Postings::word);
+        if (it == index.end()) return lines;
+
+        auto text = string_view{original.data(), original.size()};
+        for_each_offset(it->deltas, [&](uint64_t offset) {
+            if (offset + word.size() > text.size()) return false;   // the input changed behind the index
+            auto first = offset > width ? offset - width : 0;
+            auto last = std::min<uint64_t>(offset + word.size() + width, text.size());
+            lines.emplace_back(text.substr(first, offset - first),
+                               text.substr(offset, word.size()),
+                               text.substr(offset + word.size(), last - offset - word.size()));
+            return lines.size() < limit;
+        });
+        return lines;
+    }
+
+
+    // --- the persistent index ---
+    // A sidecar file per input, kept beside the chunk cache: a key of "WCPOST01", the input's size, mtime in ns,
+    // --min, token class fingerprint and canonical path, then records of {uint32 count, uint32 word length,
+    // uint32 delta bytes, word, deltas}, host byte order. When the key does not match, e.g. the input was
+    // edited, the index is built again and replaces the file; a later --contexts query only reads the file.
+    // Only kept with --contexts or --cache-dir, a plain count builds the index in memory and writes nothing.
+    class IndexFile {
+        static constexpr auto magic = "WCPOST01"sv;
+        static constexpr auto record_header = 3 * sizeof(uint32_t);
+
+        fs::path filename;
+        string key{};
+        void* storage = nullptr;
+        size_t mapped_size = 0;
+
+        template<typename T>
+        static void append(string& out, T value) { out.append(reinterpret_cast<char const*>(&value), sizeof(value)); }
+
+        // True if deltas is count whole varints, none longer than a uint64.
+        static auto well_formed(span<uint8_t const> deltas, uint32_t count) -> bool {
+            auto num_varints = 0U;
+            auto length = 0U;
+            for (auto byte: deltas) {
+                if (++length > max_varint_bytes) return false;
+                if (byte & 0x80) continue;
+                ++num_varints;
+                length = 0;
+            }
+            return length == 0 && num_varints == count;
+        }
+
+    public:
+        IndexFile(fs::path const& dir, fs::path const& input, unsigned min_length, TokenClass const& tokens) {
+            auto ec = std::error_code{};
+            if (not fs::is_regular_file(input, ec)) throw std::invalid_argument{"cannot open "s + input.string()};
+            auto const path = fs::weakly_canonical(input).string();
+            auto const mtime = fs::last_write_time(input).time_since_epoch();
+            key += magic;
+            append(key, static_cast<uint64_t>(fs::file_size(input)));
+            append(key, static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(mtime).count()));
+            append(key, static_cast<uint32_t>(min_length));
+            append(key, tokens.fingerprint());
+            append(key, static_cast<uint32_t>(path.size()));
+            key += path;
+
+            auto path_hash = 0xCBF29CE484222325ULL;
+            for (auto ch: path) path_hash = (path_hash ^ static_cast<unsigned char>(ch)) * 0x100000001B3ULL;
+            filename = dir / std::format("{}-{:016x}.postings", input.stem().string(), path_hash);
+        }
+
+        ~IndexFile() {
+            if (mapped_size > 0) munmap(storage, mapped_size);
+        }
+
+        IndexFile(IndexFile const&) = delete;
+        IndexFile& operator=(IndexFile const&) = delete;
+
+        // The index of the input, views into the mapped file; none if missing, stale or damaged.
+        auto load() -> std::optional<std::vector<Postings>> {
+            auto fd = open(filename.string().c_str(), O_RDONLY);
+            if (fd == -1) return std::nullopt;
+            struct stat st{};
+            auto const ok = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) > key.size();
+            if (ok) storage = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (not ok || storage == MAP_FAILED) return std::nullopt;
+            mapped_size = static_cast<size_t>(st.st_size);
+
+            auto bytes = string_view{static_cast<char const*>(storage), mapped_size};
+            if (not bytes.starts_with(key)) return std::nullopt;
+            bytes.remove_prefix(key.size());
+
+            auto index = std::vector<Postings>{};
+            while (not bytes.empty()) {
+                if (bytes.size() < record_header) return std::nullopt;
+                uint32_t count, length, num_deltas;
+                std::memcpy(&count, bytes.data(), sizeof(count));
+                std::memcpy(&length, bytes.data() + sizeof(count), sizeof(length));
+                std::memcpy(&num_deltas, bytes.data() + 2 * sizeof(count), sizeof(num_deltas));
+                bytes.remove_prefix(record_header);
+                if (bytes.size() < static_cast<size_t>(length) + num_deltas) return std::nullopt;
+
+                auto deltas = span{reinterpret_cast<uint8_t const*>(bytes.data() + length), num_deltas};
+                if (not well_formed(deltas, count)) return std::nullopt;
+                index.push_back(Postings{bytes.substr(0, length), count, deltas});
+                bytes.remove_prefix(static_cast<size_t>(length) + num_deltas);
+            }
+            return index;
+        }
+
+        // Replaces the file, written beside it first so a concurrent reader never sees half an index.
+        void store(std::vector<Postings> const& index) const {
+            auto out = key;
+            for (auto const& [word, count, deltas]: index) {
+                append(out, static_cast<uint32_t>(count));
+                append(out, static_cast<uint32_t>(word.size()));
+                append(out, static_cast<uint32_t>(deltas.size()));
+                out += word;
+                out.append(reinterpret_cast<char const*>(deltas.data()), deltas.size());
+            }
+
+            fs::create_directories(filename.parent_path());
+            auto tmp = fs::path{filename.string() + ".tmp"s};
+            {
+                auto file = std::ofstream{tmp, std::ios::binary | std::ios::trunc};
+                if (not file.write(out.data(), static_cast<std::streamsize>(out.size())))
+                    throw std::runtime_error{"cannot write "s + tmp.string()};
+            }
+            fs::rename(tmp, filename);
+        }
+    };
+
+    auto lower_cased(string_view word) -> string {
+        auto result = string{word};
+        kernels::fold_to_lower(result);
+        return result;
+    }
+
+    auto run(Params const& params, Statistics& stats) -> string {
+        // --- loading words and their positions, from the index file while it matches the input ---
+        auto index_file = std::optional<IndexFile>{};
+        if (not params.context_word.empty() || not params.cache_dir.empty()) {
+            index_file.emplace(params.cache_dir.empty() ? fs::path{".wordcount-cache"} : params.cache_dir,
+                               params.filename, params.min_length, policy::Configured::active);
+        }
+        auto file = std::optional<MemoryMappedFile>{};
+        auto concordance = std::optional<Concordance>{};
+        auto index = index_file ? index_file->load() : std::nullopt;
+        if (not index) {
+            file.emplace(params.filename);
+            stats.estimated_unique_words = estimate_unique_words(file->data(), params.min_length);
+            concordance.emplace(file->data(), stats.estimated_unique_words);
+
+            kernels::fold_to_lower(file->data());
+            auto first = WordIterator{file->data(), params.min_length};
+            auto last = WordIterator{};
+            r::for_each(r::subrange{first, last}, [&concordance](string_view word) {
+                concordance->add(word);
+            });
+            index = concordance->postings();
+            if (index_file) index_file->store(*index);
+        }
+        stats.unique_words = index->size();
+
+
+        // --- sorting <word,count> pairs ---
+        auto sortable = std::vector<WordFreq>{};
+        sortable.reserve(index->size());
+        for (auto const& [word, count, deltas]: *index) sortable.emplace_back(word, count);
+
+        auto by_freq_desc = [](auto const& a, auto const& b) { return a.second > b.second; };
+        auto const N = std::min<unsigned>(params.max_words, sortable.size());
+        r::partial_sort(sortable, sortable.begin() + N, by_freq_desc);
+        sortable.resize(N);
+
+
+        // --- making html span tags ---
+        auto cloud = WordCloud{params};
+        auto html = cloud.head(std::format("The {} most frequent words in {}", params.max_words, params.filename.string()));
+        html += cloud.spans(sortable);
+
+        // --- contexts, by random access into an untouched mapping of the input ---
+        if (not params.context_word.empty()) {
+            auto original = MemoryMappedFile{params.filename};
+            auto word = lower_cased(params.context_word);
+            auto lines = contexts(*index, original.data(), word, params.context_width, params.max_contexts);
+            html += std::format("<h2>Contexts of '{}'</h2>\n<pre>\n", html_escaped(word));
+            for (auto const& [before, match, after]: lines) {
+                html += std::format("{:>{}}<b>{}</b>{}\n", html_escaped(before), params.context_width,
+                                    html_escaped(match), html_escaped(after));
+            }
+            html += "</pre>\n";
+        }
+        html += WordCloud::tail();
+
+        return html;
+    }
+
+    auto run(Params const& params) -> string {
+        auto stats = Statistics{};
+        return run(params, stats);
+    }
+}
@@ -0,0 +1,63 @@
+#include <string>
+#include <string_view>
+#include <span>
+#include <filesystem>
+#include <vector>
+#include <unordered_map>
+#include <ranges>
+#include <algorithm>
+
+#include "params.hxx"
+#include "word-cloud.hxx"
+#include "statistics.hxx"
+#include "word-source.hxx"
+
+
+namespace ribomation::wordcount::coroutine {
+    namespace r = std::ranges;
+    using namespace std::string_literals;
+    using std::string;
+    using std::string_view;
+    using WordFreq = std::pair<string_view, unsigned>;
+
+    constexpr auto block_size = 1024UL * 1024;
+
+    auto run(Params const& params, Statistics& stats) -> string {
+        // --- loading words, pulled through coroutines while the next block is read ahead ---
+        struct Hash {
+            using is_transparent = void;
+            auto operator()(string_view sv) const -> size_t { return std::hash<string_view>{}(sv); }
+        };
+        auto freqs = std::unordered_map<string, unsigned, Hash, std::equal_to<>>{};
+        for (auto word: source::words(source::prefetched_blocks(params.filename, block_size), params.min_length)) {
+            if (auto it = freqs.find(word); it != freqs.end()) ++it->second;
+            else freqs.emplace(word, 1U);
+        }
+        stats.unique_words = freqs.size();
+
+
+        // --- sorting <word,count> pairs ---
+        auto sortable = std::vector<WordFreq>{};
+        sortable.reserve(freqs.size());
+        sortable.insert(sortable.end(), freqs.begin(), freqs.end());
+
+        auto by_freq_desc = [](auto const& a, auto const& b) { return a.second > b.second; };
+        auto const N = std::min<unsigned>(params.max_words, sortable.size());
+        r::partial_sort(sortable, sortable.begin() + N, by_freq_desc);
+        sortable.resize(N);
+
+
+        // --- making html span tags ---
+        auto cloud = WordCloud{params};
+        auto html = cloud.head(std::format("The {} most frequent words in {}", params.max_words, params.filename.string()));
+        html += cloud.spans(sortable);
+        html += WordCloud::tail();
+
+        return html;
+    }
+
+    auto run(Params const& params) -> string {
+        auto stats = Statistics{};
+        return run(params, stats);
+    }
+}
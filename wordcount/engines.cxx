@@ -0,0 +1,106 @@
+#include <string>
+#include <string_view>
+#include <span>
+#include <array>
+#include <vector>
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>
+#include "engines.hxx"
+
+namespace ribomation::wordcount::baseline {
+    extern auto run(Params const& P) -> std::string;
+}
+namespace ribomation::wordcount::using_reserve {
+    extern auto run(Params const& P, Statistics& S) -> std::string;
+}
+namespace ribomation::wordcount::char_fn {
+    extern auto run(Params const& P, Statistics& S) -> std::string;
+}
+namespace ribomation::wordcount::mem_map {
+    extern auto run(Params const& P, Statistics& S) -> std::string;
+}
+namespace ribomation::wordcount::ngram {
+    extern auto run(Params const& P, Statistics& S) -> std::string;
+}
+namespace ribomation::wordcount::compressed {
+    extern auto run(Params const& P, Statistics& S) -> std::string;
+}
+namespace ribomation::wordcount::concordance {
+    extern auto run(Params const& P, Statistics& S) -> std::string;
+}
+namespace ribomation::wordcount::radix_tree {
+    extern auto run(Params const& P, Statistics& S) -> std::string;
+}
+namespace ribomation::wordcount::batch {
+    extern auto run(Params const& P, Statistics& S) -> std::string;
+}
+namespace ribomation::wordcount::tfidf {
+    extern auto run(Params const& P, Statistics& S) -> std::string;
+}
+namespace ribomation::wordcount::chunk_cache {
+    extern auto run(Params const& P, Statistics& S) -> std::string;
+}
+namespace ribomation::wordcount::multi_proc {
+    extern auto run(Params const& P) -> std::string;
+    extern auto numa_nodes() -> std::vector<std::vector<unsigned>>;
+}
+
+namespace ribomation::wordcount {
+    namespace fs = std::filesystem;
+    using namespace std::string_literals;
+    using namespace std::string_view_literals;
+
+    namespace {
+        constexpr auto registry = std::array{
+            Engine{"baseline"sv, "Baseline"sv,
+                   [](Params const& P, Statistics&) { return baseline::run(P); }},
+            Engine{"using-reserve"sv, "Using reserve and partial_sort"sv, using_reserve::run},
+            Engine{"char-fn"sv, "Optimized char functions"sv, char_fn::run},
+            Engine{"mem-map-file"sv, "Memory-mapped file"sv, mem_map::run},
+            Engine{"multi-process"sv, "Multi-process map-reduce"sv,
+                   [](Params const& P, Statistics&) { return multi_proc::run(P); }},
+            Engine{"ngram"sv, "N-gram phrases"sv, ngram::run},
+            Engine{"concordance"sv, "Positional index and contexts"sv, concordance::run},
+            Engine{"radix-tree"sv, "Adaptive radix tree, prefix queries"sv, radix_tree::run},
+            Engine{"batch"sv, "Batch queries, one count for many --min/--max"sv, batch::run},
+            Engine{"tf-idf"sv, "TF-IDF across a document collection"sv, tfidf::run},
+            Engine{"chunk-cache"sv, "Content-defined chunks, cached counts"sv, chunk_cache::run},
+            Engine{"compressed"sv, "Pipelined gzip/zstd decompression"sv, compressed::run},
+        };
+
+        // Below this size, forking one worker per NUMA node costs more than it saves.
+        constexpr auto multi_process_threshold = 256ULL * 1024 * 1024;
+
+        auto by_name(std::string_view name) -> Engine const& {
+            auto it = std::ranges::find(registry, name, &Engine::name);
+            if (it == registry.end()) throw std::invalid_argument{"unknown engine "s + std::string{name}};
+            return *it;
+        }
+    }
+
+    auto engines() -> std::span<Engine const> {
+        return registry;
+    }
+
+    auto select_engine(Params const& params) -> Engine const& {
+        if (params.engine != "auto"s) return by_name(params.engine);
+
+        auto ec = std::error_code{};
+        if (params.compression != Compression::none) return by_name("compressed"sv);
+        if (not params.file_list.empty() || fs::is_directory(params.filename, ec)) return by_name("tf-idf"sv);
+        if (params.ngram > 1) return by_name("ngram"sv);
+        if (not params.context_word.empty()) return by_name("concordance"sv);
+        if (not params.prefix.empty()) return by_name("radix-tree"sv);
+        if (not params.min_lengths.empty() || not params.max_words_list.empty()) return by_name("batch"sv);
+        if (not params.cache_dir.empty()) return by_name("chunk-cache"sv);
+
+        auto mappable = fs::is_regular_file(params.filename, ec) && fs::file_size(params.filename, ec) > 0;
+        if (not mappable) return by_name("char-fn"sv);
+
+        auto large = fs::file_size(params.filename) >= multi_process_threshold;
+        if (large && multi_proc::numa_nodes().size() > 1) return by_name("multi-process"sv);
+        return by_name("mem-map-file"sv);
+    }
+
+}
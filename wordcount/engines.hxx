@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <span>
+#include "params.hxx"
+#include "statistics.hxx"
+
+namespace ribomation::wordcount {
+
+    struct Engine {
+        std::string_view name;
+        std::string_view title;
+        auto (*run)(Params const&, Statistics&) -> std::string;
+    };
+
+    // All engines linked into the executable, in optimization-step order.
+    auto engines() -> std::span<Engine const>;
+
+    // Resolves params.engine; "auto" picks compressed for gzip/zstd input, tf-idf for a directory or --file-list,
+    // ngram for --ngram 2.., concordance for --contexts WORD, radix-tree for --prefix PRE,
+    // batch for --min-list/--max-list, chunk-cache for --cache-dir DIR,
+    // otherwise by input size and whether the input can be memory-mapped.
+    auto select_engine(Params const& params) -> Engine const&;
+
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include <string_view>
+#include <span>
+#include <array>
+#include <vector>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+#include "word-iterator.hxx"
+
+namespace ribomation::wordcount {
+    namespace fs = std::filesystem;
+
+    // Cardinality sketch with 2^P one-byte registers, i.e. 16 KB and ~0.8% standard error for P=14.
+    template<unsigned P = 14>
+    class HyperLogLog {
+        static constexpr auto M = 1U << P;
+        std::array<uint8_t, M> registers{};
+
+    public:
+        void add(uint64_t hash) {
+            // splitmix64 finalizer, std::hash is not guaranteed to spread its bits well
+            hash ^= hash >> 30; hash *= 0xBF58476D1CE4E5B9ULL;
+            hash ^= hash >> 27; hash *= 0x94D049BB133111EBULL;
+            hash ^= hash >> 31;
+
+            auto index = static_cast<unsigned>(hash >> (64 - P));
+            auto rank = static_cast<uint8_t>(std::countl_zero((hash << P) | (1ULL << (P - 1))) + 1);
+            registers[index] = std::max(registers[index], rank);
+        }
+
+        void merge(HyperLogLog const& that) {
+            for (auto k = 0U; k < M; ++k) registers[k] = std::max(registers[k], that.registers[k]);
+        }
+
+        [[nodiscard]] auto estimate() const -> double {
+            auto sum = 0.0;
+            auto zeros = 0U;
+            for (auto r: registers) {
+                sum += std::ldexp(1.0, -r);
+                if (r == 0) ++zeros;
+            }
+            auto const alpha = 0.7213 / (1 + 1.079 / M);
+            auto E = alpha * M * M / sum;
+            if (E <= 2.5 * M && zeros > 0) E = M * std::log(static_cast<double>(M) / zeros);
+            return E;
+        }
+    };
+
+    // Estimates the number of distinct words (lower-cased, of --token-chars, at least min_length, not a modern word)
+    // by sketching evenly spaced windows of the input and extrapolating with Heaps' law, V = K * n^beta.
+    // The exponent beta is measured from the sample itself, by comparing every other window with all of them,
+    // so a repetitive Zipfian corpus and a short diverse one both get a realistic table size.
+    // Given ngram > 1, the distinct runs of that many consecutive words are sketched in the same pass.
+    class VocabularyEstimator {
+        static constexpr auto num_windows = 64UL;
+        static constexpr auto window_size = 64UL * 1024;
+        static constexpr auto max_ngram = 8U;
+
+        unsigned min_length;
+        size_t total_size;
+        unsigned ngram;
+        size_t sampled_size = 0;
+        HyperLogLog<> even{}, all{};
+        HyperLogLog<> even_grams{}, all_grams{};
+
+        using Letters = policy::Configured;
+        using Fold = policy::FoldInPlace;
+        using Filter = policy::NotModern;
+
+        // A window that does not start (end) at the start (end) of the input drops its first (last) partial word.
+        void sketch(std::span<char const> window, unsigned index, bool at_begin, bool at_end) {
+            sampled_size += window.size();
+            auto pos = window.begin();
+            if (not at_begin) while (pos != window.end() && Letters::is_letter(*pos)) ++pos;
+
+            char word[256];
+            auto recent = std::array<uint64_t, max_ngram>{};
+            auto num_words = 0UL;
+            while (true) {
+                while (pos != window.end() && not Letters::is_letter(*pos)) ++pos;
+                if (pos == window.end()) return;
+
+                auto length = 0UL;
+                for (; pos != window.end() && Letters::is_letter(*pos); ++pos, ++length) {
+                    if (length < sizeof(word)) word[length] = Fold::fold(*pos);
+                }
+                if (pos == window.end() && not at_end) return;
+
+                auto sv = std::string_view{word, std::min(length, sizeof(word))};
+                if (length < min_length || not Filter::keep(sv)) continue;
+
+                auto hash = std::hash<std::string_view>{}(sv);
+                all.add(hash);
+                if (index % 2 == 0) even.add(hash);
+
+                if (ngram < 2) continue;
+                recent[num_words++ % ngram] = hash;
+                if (num_words < ngram) continue;
+                auto gram = 0ULL;
+                for (auto k = 0UL; k < ngram; ++k) gram = std::rotl(gram, 7) ^ recent[(num_words + k) % ngram];
+                all_grams.add(gram);
+                if (index % 2 == 0) even_grams.add(gram);
+            }
+        }
+
+        [[nodiscard]] auto extrapolate(HyperLogLog<> const& even_, HyperLogLog<> const& all_) const -> size_t {
+            auto sampled = all_.estimate();
+            if (sampled_size >= total_size || sampled_size == 0) return static_cast<size_t>(sampled);
+
+            auto half = even_.estimate();
+            auto beta = half > 0 ? std::log2(sampled / half) : 1.0;
+            beta = std::clamp(beta, 0.3, 1.0);
+            auto scale = static_cast<double>(total_size) / static_cast<double>(sampled_size);
+            return static_cast<size_t>(sampled * std::pow(scale, beta));
+        }
+
+    public:
+        VocabularyEstimator(unsigned min_length_, size_t total_size_, unsigned ngram_ = 1)
+            : min_length(min_length_), total_size(total_size_), ngram(std::min(ngram_, max_ngram)) {}
+
+        void sample(std::span<char const> payload) {
+            if (payload.size() <= num_windows * window_size) {
+                sketch(payload, 0, true, true);
+                return;
+            }
+            auto const stride = payload.size() / num_windows;
+            for (auto k = 0U; k < num_windows; ++k) {
+                auto offset = k * stride;
+                auto window = payload.subspan(offset, window_size);
+                sketch(window, k, offset == 0, offset + window.size() == payload.size());
+            }
+        }
+
+        void sample(fs::path const& filename) {
+            if (total_size <= num_windows * window_size) {
+                auto buffer = std::vector<char>(total_size);
+                auto file = std::ifstream{filename, std::ios::binary};
+                file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                sketch(std::span{buffer.data(), static_cast<size_t>(file.gcount())}, 0, true, true);
+                return;
+            }
+            auto const stride = total_size / num_windows;
+            auto buffer = std::vector<char>(window_size);
+            auto file = std::ifstream{filename, std::ios::binary};
+            for (auto k = 0U; k < num_windows && file; ++k) {
+                auto offset = k * stride;
+                file.seekg(static_cast<std::streamoff>(offset));
+                file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                auto n = static_cast<size_t>(file.gcount());
+                sketch(std::span{buffer.data(), n}, k, offset == 0, offset + n == total_size);
+            }
+        }
+
+        [[nodiscard]] auto estimate() const -> size_t { return extrapolate(even, all); }
+
+        // distinct n-grams, zero unless constructed with ngram > 1
+        [[nodiscard]] auto estimate_ngrams() const -> size_t {
+            return ngram < 2 ? 0 : extrapolate(even_grams, all_grams);
+        }
+    };
+
+    inline auto estimate_unique_words(std::span<char const> payload, unsigned min_length) -> size_t {
+        auto estimator = VocabularyEstimator{min_length, payload.size()};
+        estimator.sample(payload);
+        return estimator.estimate();
+    }
+
+    inline auto estimate_unique_words(fs::path const& filename, unsigned min_length) -> size_t {
+        auto ec = std::error_code{};
+        if (not fs::is_regular_file(filename, ec)) return 0;
+        auto estimator = VocabularyEstimator{min_length, fs::file_size(filename)};
+        estimator.sample(filename);
+        return estimator.estimate();
+    }
+
+}
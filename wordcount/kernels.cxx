@@ -0,0 +1,14 @@
+#include <span>
+#include "kernels.hxx"
+
+namespace ribomation::wordcount::kernels {
+
+    WORDCOUNT_KERNEL
+    void fold_to_lower(std::span<char> payload) {
+        for (char& c: payload) {
+            const auto ch = static_cast<unsigned char>(c);
+            c = static_cast<char>(ch + (static_cast<unsigned char>(ch - 'A') < 26U ? 'a' - 'A' : 0));
+        }
+    }
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <span>
+
+// Hot kernels and loops are compiled for several x86-64 ISA levels and the best one is picked at program
+// start-up (GNU ifunc), unless the whole tree already is tuned for the build host via -march=native.
+// What a clone calls is inlined into it as usual, where the ISA levels allow it.
+#if defined(__x86_64__) && defined(__GNUC__) && not defined(WORDCOUNT_NATIVE)
+#define WORDCOUNT_KERNEL __attribute__((target_clones("arch=x86-64-v4", "arch=x86-64-v3", "arch=x86-64-v2", "default")))
+#else
+#define WORDCOUNT_KERNEL
+#endif
+
+namespace ribomation::wordcount::kernels {
+
+    // Lower-cases A-Z in place, all other bytes are left untouched.
+    void fold_to_lower(std::span<char> payload);
+
+}
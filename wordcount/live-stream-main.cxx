@@ -0,0 +1,15 @@
+#include <string>
+#include "params.hxx"
+
+using ribomation::wordcount::Params;
+
+namespace ribomation::wordcount::live {
+    extern void run(Params const& P);
+}
+
+int main(int argc, char* argv[]) {
+    auto params = Params{};
+    params.parse(argc, argv);
+
+    ribomation::wordcount::live::run(params);
+}
@@ -0,0 +1,384 @@
+#include <string>
+#include <string_view>
+#include <span>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <print>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+
+#include "params.hxx"
+#include "word-cloud.hxx"
+#include "block-tokenizer.hxx"
+
+
+namespace ribomation::wordcount::live {
+    namespace fs = std::filesystem;
+    namespace c = std::chrono;
+    using namespace std::string_literals;
+    using namespace std::string_view_literals;
+    using std::string;
+    using std::string_view;
+    using WordFreq = std::pair<string_view, unsigned>;
+    using Clock = c::steady_clock;
+
+    constexpr auto num_buckets = 60U;
+
+
+    // Interns words to dense ids; the key strings live in the map nodes and never move.
+    // The id of a word that left the window is recycled, so ids stay below the peak number of words in it.
+    class Vocabulary {
+        struct Hash {
+            using is_transparent = void;
+            auto operator()(string_view sv) const -> size_t { return std::hash<string_view>{}(sv); }
+        };
+
+        std::unordered_map<string, uint32_t, Hash, std::equal_to<>> ids{};
+        std::vector<string_view> words{};
+        std::vector<uint32_t> free_ids{};
+
+    public:
+        auto id_of(string_view word) -> uint32_t {
+            if (auto it = ids.find(word); it != ids.end()) return it->second;
+
+            auto id = static_cast<uint32_t>(words.size());
+            if (free_ids.empty()) {
+                words.emplace_back();
+            } else {
+                id = free_ids.back();
+                free_ids.pop_back();
+            }
+            auto [it, _] = ids.emplace(string{word}, id);
+            words[id] = it->first;
+            return id;
+        }
+
+        // Forgets the word of id, which is handed out again by id_of().
+        void release(uint32_t id) {
+            ids.erase(ids.find(words[id]));
+            words[id] = {};
+            free_ids.push_back(id);
+        }
+
+        [[nodiscard]] auto word(uint32_t id) const -> string_view { return words[id]; }
+
+        [[nodiscard]] auto size() const -> size_t { return words.size() - free_ids.size(); }
+    };
+
+    // Stream-summary: words are kept in groups of equal count, the groups in a list ordered by
+    // descending count. Incrementing or decrementing a word moves it to the neighbour group in O(1),
+    // and the top-K is read off the head of the list in O(K), without any sorting.
+    // Nodes are indexed by word id and reused with the ids; trailing unused nodes are dropped.
+    class FrequencyIndex {
+        static constexpr auto none = ~0U;
+
+        struct Group {
+            unsigned count = 0;
+            uint32_t prev = none, next = none;  // towards higher, lower counts
+            uint32_t first_word = none;
+        };
+
+        struct Node {
+            uint32_t group = none;
+            uint32_t prev = none, next = none;  // siblings in the group
+        };
+
+        std::vector<Group> groups{};
+        std::vector<uint32_t> free_groups{};
+        std::vector<Node> nodes{};
+        uint32_t head = none, tail = none;
+
+        auto new_group(unsigned count, uint32_t prev, uint32_t next) -> uint32_t {
+            auto g = uint32_t{};
+            if (free_groups.empty()) {
+                g = static_cast<uint32_t>(groups.size());
+                groups.emplace_back();
+            } else {
+                g = free_groups.back();
+                free_groups.pop_back();
+            }
+            groups[g] = Group{count, prev, next, none};
+            if (prev == none) head = g; else groups[prev].next = g;
+            if (next == none) tail = g; else groups[next].prev = g;
+            return g;
+        }
+
+        void unlink(uint32_t w) {
+            auto& n = nodes[w];
+            auto& g = groups[n.group];
+            if (n.prev == none) g.first_word = n.next; else nodes[n.prev].next = n.next;
+            if (n.next != none) nodes[n.next].prev = n.prev;
+
+            if (g.first_word == none) {
+                if (g.prev == none) head = g.next; else groups[g.prev].next = g.next;
+                if (g.next == none) tail = g.prev; else groups[g.next].prev = g.prev;
+                free_groups.push_back(n.group);
+            }
+            n = Node{};
+        }
+
+        void link(uint32_t w, uint32_t g) {
+            auto& n = nodes[w];
+            n = Node{g, none, groups[g].first_word};
+            if (n.next != none) nodes[n.next].prev = w;
+            groups[g].first_word = w;
+        }
+
+    public:
+        [[nodiscard]] auto count(uint32_t w) const -> unsigned {
+            return w < nodes.size() && nodes[w].group != none ? groups[nodes[w].group].count : 0;
+        }
+
+        [[nodiscard]] auto alone(uint32_t w) const -> bool {
+            return groups[nodes[w].group].first_word == w && nodes[w].next == none;
+        }
+
+        void increment(uint32_t w) {
+            if (w >= nodes.size()) nodes.resize(w + 1);
+
+            auto const current = nodes[w].group;
+            auto const target_count = count(w) + 1;
+            auto const above = current == none ? tail : groups[current].prev;
+
+            auto target = uint32_t{};
+            if (above != none && groups[above].count == target_count) {
+                target = above;
+            } else if (current != none && alone(w)) {
+                groups[current].count = target_count;
+                return;
+            } else {
+                target = new_group(target_count, above, current);
+            }
+            if (current != none) unlink(w);
+            link(w, target);
+        }
+
+        // Returns true if the count of w dropped to zero, i.e. w left the index.
+        auto decrement(uint32_t w) -> bool {
+            auto const current = w < nodes.size() ? nodes[w].group : none;
+            if (current == none) return false;
+
+            auto const target_count = groups[current].count - 1;
+            auto const below = groups[current].next;
+            if (target_count == 0) {
+                unlink(w);
+                while (not nodes.empty() && nodes.back().group == none) nodes.pop_back();
+                return true;
+            }
+
+            auto target = uint32_t{};
+            if (below != none && groups[below].count == target_count) {
+                target = below;
+            } else if (alone(w)) {
+                groups[current].count = target_count;
+                return false;
+            } else {
+                target = new_group(target_count, current, below);
+            }
+            unlink(w);
+            link(w, target);
+            return false;
+        }
+
+        template<typename Consumer>
+        void top(unsigned K, Consumer&& consume) const {
+            for (auto g = head; g != none && K > 0; g = groups[g].next) {
+                for (auto w = groups[g].first_word; w != none && K > 0; w = nodes[w].next, --K) {
+                    consume(w, groups[g].count);
+                }
+            }
+        }
+    };
+
+    // Ring of time or volume buckets, each holding the word ids added while it was current.
+    // Expiring the oldest bucket decrements each of its words once, so every word is
+    // added and expired in O(1), amortized over the words of the bucket. A word whose
+    // count drops to zero is no longer referenced by any bucket, and its id is released.
+    class SlidingWindow {
+        std::vector<std::vector<uint32_t>> buckets = std::vector<std::vector<uint32_t>>(num_buckets);
+        unsigned current = 0;
+        size_t num_words = 0;
+
+    public:
+        void add(uint32_t w) {
+            buckets[current].push_back(w);
+            ++num_words;
+        }
+
+        void rotate(FrequencyIndex& index, Vocabulary& vocabulary) {
+            current = (current + 1) % num_buckets;
+            for (auto w: buckets[current]) {
+                if (index.decrement(w)) vocabulary.release(w);
+            }
+            num_words -= buckets[current].size();
+            buckets[current].clear();
+        }
+
+        [[nodiscard]] auto size() const -> size_t { return num_words; }
+    };
+
+    // The page reloads itself every second, so a browser follows the snapshots.
+    auto render_html(Params const& params, std::vector<WordFreq>& items, WordCloud& cloud) -> string {
+        auto html = cloud.head(std::format("The {} most frequent words in {}", params.max_words, params.filename.string()), 1);
+        html += cloud.spans(items);
+        html += WordCloud::tail();
+        return html;
+    }
+
+    // A JSON string body: quote, backslash and control characters escaped, other bytes as is.
+    auto json_escape(string_view word) -> string {
+        auto escaped = string{};
+        escaped.reserve(word.size());
+        for (auto ch: word) {
+            if (ch == '"' || ch == '\\') {
+                escaped += '\\';
+                escaped += ch;
+            } else if (static_cast<unsigned char>(ch) < 0x20) {
+                escaped += std::format("\\u{:04x}", static_cast<unsigned>(ch));
+            } else {
+                escaped += ch;
+            }
+        }
+        return escaped;
+    }
+
+    auto render_json(std::vector<WordFreq> const& items) -> string {
+        auto json = string{};
+        json.reserve(20 + items.size() * 40);
+        json += "[";
+        for (auto const& [word, freq]: items) {
+            if (json.size() > 1) json += ",";
+            json += std::format(R"({{"word":"{}","count":{}}})", json_escape(word), freq);
+        }
+        json += "]\n";
+        return json;
+    }
+
+    // Written next to the final name and renamed over it, so a reader never sees a half snapshot.
+    void store_atomically(fs::path const& filename, string const& content) {
+        auto tmp = fs::path{filename.string() + ".tmp"s};
+        auto fd = open(tmp.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1) throw std::runtime_error{"cannot open outfile "s + tmp.string()};
+        auto rest = string_view{content};
+        while (not rest.empty()) {
+            auto n = write(fd, rest.data(), rest.size());
+            if (n == -1 && errno == EINTR) continue;
+            if (n == -1) {
+                close(fd);
+                throw std::runtime_error{"write failed: "s + strerror(errno)};
+            }
+            rest.remove_prefix(static_cast<size_t>(n));
+        }
+        close(fd);
+        fs::rename(tmp, filename);
+    }
+
+    void run(Params const& params) {
+        if (params.window_mb == 0 && params.window_seconds == 0)
+            throw std::invalid_argument{"--window-sec must be at least 1, or give --window-mb"};
+        policy::Configured::use(TokenClass{params.token_chars});
+        auto const stdin_input = params.filename == fs::path{"-"};
+        auto fd = stdin_input ? STDIN_FILENO : open(params.filename.string().c_str(), O_RDONLY);
+        if (fd == -1) throw std::invalid_argument{"cannot open "s + params.filename.string()};
+        struct stat st{};
+        if (fstat(fd, &st) == -1) {
+            auto error = "cannot stat "s + params.filename.string() + ": "s + strerror(errno);
+            if (not stdin_input) close(fd);
+            throw std::runtime_error{error};
+        }
+        auto const follow = S_ISREG(st.st_mode);    // a regular file is followed like tail -f, a pipe ends at EOF
+
+        auto const by_volume = params.window_mb > 0;
+        auto const bucket_bytes = params.window_mb * 1024ULL * 1024 / num_buckets;
+        auto const bucket_time = c::duration_cast<Clock::duration>(c::seconds{params.window_seconds}) / num_buckets;
+        auto const interval = c::milliseconds{params.interval_ms};
+        auto const outfile = fs::path{"."} / fs::path{(stdin_input ? "stdin"s : params.filename.stem().string()) + "." + params.format};
+
+        auto vocabulary = Vocabulary{};
+        auto index = FrequencyIndex{};
+        auto window = SlidingWindow{};
+        auto tokenizer = BlockTokenizer{params.min_length};
+        auto cloud = WordCloud{params};
+        auto count_word = [&](string_view word) {
+            auto w = vocabulary.id_of(word);
+            index.increment(w);
+            window.add(w);
+        };
+
+        auto bucket_end = Clock::now() + bucket_time;
+        auto bucket_filled = 0ULL;
+        auto next_emit = Clock::now() + interval;
+        auto snapshots = 0UL;
+        auto items = std::vector<WordFreq>{};
+        items.reserve(params.max_words);
+
+        auto emit_snapshot = [&] {
+            auto start = Clock::now();
+            items.clear();
+            index.top(params.max_words, [&](uint32_t w, unsigned count) {
+                items.emplace_back(vocabulary.word(w), count);
+            });
+            if (items.empty()) return;
+
+            auto content = params.format == "json"s ? render_json(items) : render_html(params, items, cloud);
+            store_atomically(outfile, content);
+            auto elapsed = c::duration_cast<c::microseconds>(Clock::now() - start);
+            std::println("snapshot {}: {} words in window, {} distinct, emitted in {} us",
+                         ++snapshots, window.size(), vocabulary.size(), elapsed.count());
+            std::fflush(stdout);
+        };
+
+        auto buffer = std::vector<char>(64 * 1024);
+        for (auto eof = false; not eof;) {
+            auto now = Clock::now();
+            if (not by_volume) {
+                for (; now >= bucket_end; bucket_end += bucket_time) window.rotate(index, vocabulary);
+            }
+            if (now >= next_emit) {
+                emit_snapshot();
+                next_emit = now + interval;
+            }
+
+            auto wait = c::duration_cast<c::milliseconds>(next_emit - now);
+            if (not follow) {
+                auto pfd = pollfd{fd, POLLIN, 0};
+                if (poll(&pfd, 1, static_cast<int>(std::max(wait.count(), 0L))) == 0) continue;
+            }
+
+            // in volume mode a read ends where the bucket does, so every bucket holds bucket_bytes exactly
+            auto const capacity = by_volume ? std::min<size_t>(buffer.size(), bucket_bytes - bucket_filled) : buffer.size();
+            auto n = read(fd, buffer.data(), capacity);
+            if (n == -1 && errno == EINTR) continue;
+            if (n == -1) throw std::runtime_error{"read failed: "s + strerror(errno)};
+            if (n == 0) {
+                if (not follow) {
+                    eof = true;
+                    tokenizer.finish(count_word);
+                    continue;
+                }
+                std::this_thread::sleep_for(std::min(wait, c::milliseconds{100}));
+                continue;
+            }
+
+            tokenizer.feed(std::span{buffer.data(), static_cast<size_t>(n)}, count_word);
+            if (by_volume && (bucket_filled += static_cast<size_t>(n)) >= bucket_bytes) {
+                window.rotate(index, vocabulary);
+                bucket_filled = 0;
+            }
+        }
+        emit_snapshot();
+        if (not stdin_input) close(fd);
+    }
+}
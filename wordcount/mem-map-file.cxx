@@ -1,25 +1,19 @@
 #include <string>
 #include <string_view>
-#include <span>
 #include <filesystem>
-#include <stdexcept>
-#include <iterator>
 #include <vector>
-#include <unordered_set>
-#include <unordered_map>
 #include <ranges>
 #include <algorithm>
 #include <random>
 
-#include <cstring>
-#include <cerrno>
-
-#include <unistd.h>
-#include <fcntl.h>
-#include <sys/types.h>
-#include <sys/mman.h>
-
 #include "params.hxx"
+#include "word-cloud.hxx"
+#include "statistics.hxx"
+#include "hyperloglog.hxx"
+#include "mem-map-file.hxx"
+#include "ranked-dump.hxx"
+#include "compact-table.hxx"
+#include "kernels.hxx"
 
 
 namespace ribomation::wordcount::mem_map {
@@ -34,161 +28,37 @@ namespace ribomation::wordcount::mem_map {
     using WordFreq = std::pair<string_view, unsigned>;
 
 
-    class MemoryMappedFile {
-        void* storage = nullptr;
-        size_t size = 0;
-
-    public:
-        explicit MemoryMappedFile(const fs::path& filename) {
-            const auto fd = open(filename.string().c_str(), O_RDWR);
-            if (fd == -1) throw std::invalid_argument{"cannot open "s + filename.string()};
-
-            size = fs::file_size(filename);
-            storage = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
-            if (storage == MAP_FAILED) throw std::runtime_error{"mmap failed: "s + strerror(errno)};
-            close(fd);
-        }
-
-        ~MemoryMappedFile() {
-            munmap(storage, size);
-        }
-
-        [[nodiscard]] auto data() const -> std::span<char> {
-            return std::span{static_cast<char *>(storage), size};
-        }
-
-        MemoryMappedFile() = delete;
-
-        MemoryMappedFile(MemoryMappedFile const&) = delete;
-
-        MemoryMappedFile& operator=(MemoryMappedFile const&) = delete;
-
-        MemoryMappedFile(MemoryMappedFile&) noexcept = delete;
-
-        MemoryMappedFile& operator=(MemoryMappedFile&&) noexcept = delete;
-    };
-
-    class WordIterator {
-        span<char> payload{};
-        span<char>::iterator current_pos{};
-        unsigned min_length{};
-        string_view current_word{};
-        bool at_end = true;
-
-    public:
-        using iterator_concept = std::input_iterator_tag;
-        using iterator_category = std::input_iterator_tag;
-        using value_type = string_view;
-        using reference = value_type;
-        using pointer = void;
-        using difference_type = std::ptrdiff_t;
-
-        WordIterator() = default;
-
-        explicit WordIterator(span<char> payload_, unsigned min_length_)
-            : payload(payload_), current_pos(payload.begin()), min_length(min_length_) {
-            read_next();
-        }
-
-        reference operator*() const { return current_word; }
-
-        WordIterator& operator++() {
-            read_next();
-            return *this;
-        }
-
-        WordIterator operator++(int) {
-            auto tmp = *this;
-            ++(*this);
-            return tmp;
-        }
-
-        friend bool operator==(WordIterator const& a, WordIterator const& b) {
-            if (a.at_end && b.at_end) return true;
-            return a.at_end == b.at_end &&
-                   a.payload.data() == b.payload.data() &&
-                   a.current_pos == b.current_pos;
-        }
-
-        friend bool operator!=(WordIterator const& a, WordIterator const& b) {
-            return !(a == b);
-        }
-
-    private:
-        void read_next() {
-            while (true) {
-                while (current_pos != payload.end() && !is_letter(*current_pos)) {
-                    ++current_pos;
-                }
-
-                if (current_pos == payload.end()) {
-                    at_end = true;
-                    current_word = {};
-                    return;
-                }
-
-                auto start = current_pos;
-                while (current_pos != payload.end() && is_letter(*current_pos)) {
-                    *current_pos = to_lower(*current_pos);
-                    ++current_pos;
-                }
-
-                auto sp = span<char>(start, current_pos);;
-                auto sv = string_view{sp.data(), sp.size()};
-                if (sv.size() < min_length || modern_words.contains(sv)) {
-                    continue;
-                }
-
-                current_word = sv;
-                at_end = false;
-                break;
-            }
-        }
-
-        inline static std::unordered_set<string_view> const modern_words = {
-            "electronic"sv, "distributed"sv, "copies"sv, "copyright"sv, "gutenberg"sv
-        };
-
-        static bool is_letter(char c) {
-            const auto ch = static_cast<unsigned char>(c);
-            return ('A' <= ch && ch <= 'Z')
-                   || ('a' <= ch && ch <= 'z')
-                   || ch == '\'';
-        }
-
-        static char to_lower(char c) {
-            if ('A' <= c && c <= 'Z') {
-                return static_cast<char>((c - 'A') + 'a');
-            }
-            return c;
-        }
-    };
+    WORDCOUNT_KERNEL
+    void count_words(span<char> text, unsigned min_length, CompactWordTable& freqs) {
+        for_each_word<span<char>, policy::Configured, policy::PreFolded, policy::NotModern>(
+            text, min_length, [&freqs](string_view word) { freqs.add(word); });
+    }
 
-    auto run(Params const& params) -> string {
+    auto run(Params const& params, Statistics& stats) -> string {
         // --- loading words ---
-        auto freqs = std::unordered_map<string_view, unsigned>{};
-        auto filesize = fs::file_size(params.filename);
-        auto approx_total_words = filesize / 8;
-        auto approx_unique_words = approx_total_words / 4;
-        freqs.reserve(approx_unique_words);
-
         auto file = MemoryMappedFile{params.filename};
-        auto first = WordIterator{file.data(), params.min_length};
-        auto last = WordIterator{};
-        r::for_each(r::subrange{first, last}, [&freqs](string_view word) {
-            ++freqs[word];
-        });
+        stats.estimated_unique_words = estimate_unique_words(file.data(), params.min_length);
+        kernels::fold_to_lower(file.data());
+        file.freeze();
+
+        auto freqs = CompactWordTable{file.data(), stats.estimated_unique_words};
+        count_words(file.data(), params.min_length, freqs);
+        stats.unique_words = freqs.size();
 
 
         // --- sorting <word,count> pairs ---
         auto sortable = std::vector<WordFreq>{};
         sortable.reserve(freqs.size());
-        sortable.insert(sortable.end(),
-                        std::make_move_iterator(freqs.begin()), std::make_move_iterator(freqs.end()));
+        freqs.for_each([&sortable](string_view word, unsigned count) { sortable.emplace_back(word, count); });
 
-        auto by_freq_desc = [](auto const& a, auto const& b) { return a.second > b.second; };
         auto const N = std::min<unsigned>(params.max_words, sortable.size());
-        r::partial_sort(sortable, sortable.begin() + N, by_freq_desc);
+        if (params.dump_file.empty()) {
+            auto by_freq_desc = [](auto const& a, auto const& b) { return a.second > b.second; };
+            r::partial_sort(sortable, sortable.begin() + N, by_freq_desc);
+        } else {
+            rank_by_frequency(sortable);
+            dump_ranked(params.dump_file, params.dump_format, sortable);
+        }
         sortable.resize(N);
 
 
@@ -215,7 +85,7 @@ namespace ribomation::wordcount::mem_map {
             }
 
             auto operator()(WordFreq& wf) -> string {
-                auto word = wf.first;
+                auto word = html_escaped(wf.first);
                 auto freq = wf.second;
                 auto size = static_cast<unsigned>((freq - min_freq) * scale + params.min_font);
                 auto colr = color();
@@ -240,10 +110,15 @@ namespace ribomation::wordcount::mem_map {
                     <title>Word Frequencies</title>
                 </head>
             <body>)";
-        html += std::format("<h1>The {} most frequent words in {}</h1>", params.max_words, params.filename.string());
+        html += std::format("<h1>The {} most frequent words in {}</h1>", params.max_words, html_escaped(params.filename.string()));
         for (WordFreq& wf: sortable) html += to_span_tag(wf) + "\n";
         html += "</body></html>\n";
 
         return html;
     }
+
+    auto run(Params const& params) -> string {
+        auto stats = Statistics{};
+        return run(params, stats);
+    }
 }
@@ -0,0 +1,72 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <span>
+#include <filesystem>
+#include <stdexcept>
+
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+
+#include "word-iterator.hxx"
+
+
+namespace ribomation::wordcount::mem_map {
+    namespace fs = std::filesystem;
+    using namespace std::string_literals;
+    using namespace std::string_view_literals;
+    using std::string_view;
+    using std::span;
+
+
+    class MemoryMappedFile {
+        void* storage = nullptr;
+        size_t size = 0;
+
+    public:
+        explicit MemoryMappedFile(const fs::path& filename) {
+            const auto fd = open(filename.string().c_str(), O_RDWR);
+            if (fd == -1) throw std::invalid_argument{"cannot open "s + filename.string()};
+
+            size = fs::file_size(filename);
+            storage = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (storage == MAP_FAILED) throw std::runtime_error{"mmap failed: "s + strerror(errno)};
+            close(fd);
+        }
+
+        ~MemoryMappedFile() {
+            munmap(storage, size);
+        }
+
+        [[nodiscard]] auto data() const -> std::span<char> {
+            return std::span{static_cast<char *>(storage), size};
+        }
+
+        // Makes the mapping read-only, e.g. once case-folded, while words are still referenced into it.
+        void freeze() {
+            if (size > 0 && mprotect(storage, size, PROT_READ) == -1)
+                throw std::runtime_error{"mprotect failed: "s + strerror(errno)};
+        }
+
+        MemoryMappedFile() = delete;
+
+        MemoryMappedFile(MemoryMappedFile const&) = delete;
+
+        MemoryMappedFile& operator=(MemoryMappedFile const&) = delete;
+
+        MemoryMappedFile(MemoryMappedFile&) noexcept = delete;
+
+        MemoryMappedFile& operator=(MemoryMappedFile&&) noexcept = delete;
+    };
+
+    // Words of a mapping already case-folded, e.g. by kernels::fold_to_lower()
+    using WordIterator = wordcount::WordIterator<span<char>, policy::Configured, policy::PreFolded, policy::NotModern>;
+
+    // Words of a mapping not yet case-folded, lower-cased in place while read
+    using FoldingWordIterator = wordcount::WordIterator<span<char>, policy::Configured, policy::FoldInPlace, policy::NotModern>;
+}
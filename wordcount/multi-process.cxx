@@ -0,0 +1,257 @@
+#include <string>
+#include <string_view>
+#include <span>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <ranges>
+#include <algorithm>
+
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+
+#include <unistd.h>
+#include <signal.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+
+#include "params.hxx"
+#include "word-cloud.hxx"
+#include "mem-map-file.hxx"
+#include "ranked-dump.hxx"
+#include "kernels.hxx"
+
+
+namespace ribomation::wordcount::multi_proc {
+    namespace fs = std::filesystem;
+    namespace r = std::ranges;
+    using namespace std::string_literals;
+    using std::string;
+    using std::string_view;
+    using std::span;
+    using mem_map::MemoryMappedFile;
+    using WordIterator = mem_map::FoldingWordIterator;
+    using WordFreq = std::pair<string_view, unsigned>;
+
+
+    // CPU ids of each NUMA node, as listed in /sys/devices/system/node/node*/cpulist, in node order.
+    // Node ids need not be contiguous (offlined or hot-plugged nodes), so every nodeN entry is read.
+    // A box without that directory (or a non-NUMA kernel) is treated as a single node.
+    auto numa_nodes() -> std::vector<std::vector<unsigned>> {
+        auto by_id = std::vector<std::pair<unsigned long, std::vector<unsigned>>>{};
+        auto ec = std::error_code{};
+        for (auto const& entry: fs::directory_iterator{"/sys/devices/system/node", ec}) {
+            auto const name = entry.path().filename().string();
+            if (not name.starts_with("node") || name.size() == 4
+                || name.find_first_not_of("0123456789", 4) != string::npos) continue;
+
+            auto cpulist = std::ifstream{entry.path() / "cpulist"};
+            auto cpus = std::vector<unsigned>{};
+            for (string range; std::getline(cpulist, range, ',');) {
+                auto dash = range.find('-');
+                auto first = static_cast<unsigned>(std::stoul(range.substr(0, dash)));
+                auto last = dash == string::npos ? first : static_cast<unsigned>(std::stoul(range.substr(dash + 1)));
+                for (auto cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+            }
+            if (not cpus.empty()) by_id.emplace_back(std::stoul(name.substr(4)), std::move(cpus));
+        }
+        r::sort(by_id, {}, &std::pair<unsigned long, std::vector<unsigned>>::first);
+
+        auto nodes = std::vector<std::vector<unsigned>>{};
+        for (auto& [id, cpus]: by_id) nodes.push_back(std::move(cpus));
+        if (nodes.empty()) nodes.emplace_back();
+        return nodes;
+    }
+
+    // Restricts the calling process to those of cpus it may run on at all, e.g. inside a cpuset;
+    // if there are none, it is left unpinned.
+    void pin_to(std::vector<unsigned> const& cpus) {
+        auto allowed = cpu_set_t{};
+        if (cpus.empty() || sched_getaffinity(0, sizeof(allowed), &allowed) == -1) return;
+        auto mask = cpu_set_t{};
+        CPU_ZERO(&mask);
+        for (auto cpu: cpus) {
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) CPU_SET(cpu, &mask);
+        }
+        if (CPU_COUNT(&mask) == 0) return;
+        if (sched_setaffinity(0, sizeof(mask), &mask) == -1)
+            throw std::runtime_error{"cannot pin a worker: "s + strerror(errno)};
+    }
+
+    // Splits the payload into N ranges, moving each cut forward so no word straddles two workers.
+    auto split_ranges(span<char> payload, unsigned N) -> std::vector<span<char>> {
+        auto cuts = std::vector<size_t>{0};
+        for (auto k = 1U; k < N; ++k) {
+            auto pos = std::max(cuts.back(), payload.size() * k / N);
+            while (pos < payload.size() && pos > 0 && WordIterator::is_letter(payload[pos - 1])) ++pos;
+            cuts.push_back(pos);
+        }
+        cuts.push_back(payload.size());
+
+        auto ranges = std::vector<span<char>>{};
+        for (auto k = 0U; k < N; ++k) ranges.push_back(payload.subspan(cuts[k], cuts[k + 1] - cuts[k]));
+        return ranges;
+    }
+
+    // Layout of a worker's result region:
+    //   ResultHeader, then num_words records of {uint32 count, uint32 length, length chars}
+    struct ResultHeader {
+        uint64_t num_words;
+        uint64_t num_bytes;
+    };
+
+    WORDCOUNT_KERNEL
+    void count_words(span<char> range, unsigned min_length, std::unordered_map<string_view, unsigned>& freqs) {
+        for (auto it = WordIterator{range, min_length}; it != WordIterator{}; ++it) ++freqs[*it];
+    }
+
+    [[noreturn]] void worker(span<char> range, unsigned min_length, std::vector<unsigned> const& cpus, int result_fd) {
+        try {
+            pin_to(cpus);
+
+            auto freqs = std::unordered_map<string_view, unsigned>{};
+            freqs.reserve(range.size() / 8 / 4);
+            count_words(range, min_length, freqs);
+
+            auto num_bytes = sizeof(ResultHeader);
+            for (auto const& [word, count]: freqs) num_bytes += 2 * sizeof(uint32_t) + word.size();
+            if (ftruncate(result_fd, static_cast<off_t>(num_bytes)) == -1) _exit(2);
+
+            auto storage = mmap(nullptr, num_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, result_fd, 0);
+            if (storage == MAP_FAILED) _exit(3);
+
+            auto out = static_cast<char *>(storage);
+            auto header = ResultHeader{freqs.size(), num_bytes};
+            std::memcpy(out, &header, sizeof(header));
+            out += sizeof(header);
+            for (auto const& [word, count]: freqs) {
+                auto cnt = static_cast<uint32_t>(count);
+                auto len = static_cast<uint32_t>(word.size());
+                std::memcpy(out, &cnt, sizeof(cnt));
+                std::memcpy(out + sizeof(cnt), &len, sizeof(len));
+                std::memcpy(out + 2 * sizeof(uint32_t), word.data(), len);
+                out += 2 * sizeof(uint32_t) + len;
+            }
+            munmap(storage, num_bytes);
+            _exit(0);
+        } catch (...) {
+            _exit(1);
+        }
+    }
+
+    class WorkerResult {
+        int fd = -1;
+        void* storage = nullptr;
+        size_t size = 0;
+
+    public:
+        WorkerResult() {
+            fd = memfd_create("wordcount-result", MFD_CLOEXEC);
+            if (fd == -1) throw std::runtime_error{"memfd_create failed: "s + strerror(errno)};
+        }
+
+        ~WorkerResult() {
+            if (storage != nullptr) munmap(storage, size);
+            if (fd != -1) close(fd);
+        }
+
+        WorkerResult(WorkerResult const&) = delete;
+        WorkerResult& operator=(WorkerResult const&) = delete;
+
+        [[nodiscard]] int handle() const { return fd; }
+
+        template<typename Consumer>
+        void for_each(Consumer&& consume) {
+            struct stat st{};
+            if (fstat(fd, &st) == -1) throw std::runtime_error{"fstat failed: "s + strerror(errno)};
+            size = static_cast<size_t>(st.st_size);
+            if (size < sizeof(ResultHeader)) throw std::runtime_error{"truncated worker result"s};
+
+            storage = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            if (storage == MAP_FAILED) {
+                storage = nullptr;
+                throw std::runtime_error{"mmap failed: "s + strerror(errno)};
+            }
+
+            auto in = static_cast<char const*>(storage);
+            auto header = ResultHeader{};
+            std::memcpy(&header, in, sizeof(header));
+            in += sizeof(header);
+            for (auto k = 0ULL; k < header.num_words; ++k) {
+                auto cnt = uint32_t{};
+                auto len = uint32_t{};
+                std::memcpy(&cnt, in, sizeof(cnt));
+                std::memcpy(&len, in + sizeof(cnt), sizeof(len));
+                consume(string_view{in + 2 * sizeof(uint32_t), len}, cnt);
+                in += 2 * sizeof(uint32_t) + len;
+            }
+        }
+    };
+
+    auto run(Params const& params) -> string {
+        // --- map: one pinned worker process per NUMA node (or per group) ---
+        auto nodes = numa_nodes();
+        auto const N = params.workers > 0 ? params.workers : static_cast<unsigned>(nodes.size());
+
+        auto file = MemoryMappedFile{params.filename};
+        auto ranges = split_ranges(file.data(), N);
+        auto results = std::vector<std::unique_ptr<WorkerResult>>{};
+        auto pids = std::vector<pid_t>{};
+        for (auto k = 0U; k < N; ++k) {
+            results.push_back(std::make_unique<WorkerResult>());
+            auto pid = fork();
+            if (pid == -1) {
+                auto const error = errno;
+                for (auto started: pids) kill(started, SIGKILL);
+                for (auto started: pids) waitpid(started, nullptr, 0);
+                throw std::runtime_error{"fork failed: "s + strerror(error)};
+            }
+            if (pid == 0) worker(ranges[k], params.min_length, nodes[k % nodes.size()], results.back()->handle());
+            pids.push_back(pid);
+        }
+
+        auto failed = 0U;
+        for (auto pid: pids) {
+            auto status = 0;
+            if (waitpid(pid, &status, 0) == -1 || not WIFEXITED(status) || WEXITSTATUS(status) != 0) ++failed;
+        }
+        if (failed > 0) throw std::runtime_error{std::format("{} of {} workers failed", failed, N)};
+
+        // --- reduce: merge the compact results, words stay in the worker regions ---
+        auto freqs = std::unordered_map<string_view, unsigned>{};
+        for (auto& result: results) {
+            result->for_each([&freqs](string_view word, unsigned count) { freqs[word] += count; });
+        }
+
+
+        // --- sorting <word,count> pairs ---
+        auto sortable = std::vector<WordFreq>{};
+        sortable.reserve(freqs.size());
+        sortable.insert(sortable.end(), freqs.begin(), freqs.end());
+
+        auto const M = std::min<unsigned>(params.max_words, sortable.size());
+        if (params.dump_file.empty()) {
+            auto by_freq_desc = [](auto const& a, auto const& b) { return a.second > b.second; };
+            r::partial_sort(sortable, sortable.begin() + M, by_freq_desc);
+        } else {
+            rank_by_frequency(sortable);
+            dump_ranked(params.dump_file, params.dump_format, sortable);
+        }
+        sortable.resize(M);
+
+
+        // --- making html span tags ---
+        auto cloud = WordCloud{params};
+        auto html = cloud.head(std::format("The {} most frequent words in {}", params.max_words, params.filename.string()));
+        html += cloud.spans(sortable);
+        html += WordCloud::tail();
+
+        return html;
+    }
+}
@@ -0,0 +1,265 @@
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <stdexcept>
+#include <array>
+#include <vector>
+#include <ranges>
+#include <algorithm>
+#include <span>
+#include <functional>
+#include <bit>
+#include <cstdint>
+
+#include "params.hxx"
+#include "word-cloud.hxx"
+#include "statistics.hxx"
+#include "hyperloglog.hxx"
+#include "mem-map-file.hxx"
+#include "kernels.hxx"
+
+
+namespace ribomation::wordcount::ngram {
+    namespace fs = std::filesystem;
+    namespace r = std::ranges;
+    using namespace std::string_literals;
+    using std::string;
+    using std::string_view;
+    using mem_map::MemoryMappedFile;
+    using mem_map::WordIterator;
+    using WordFreq = std::pair<string, unsigned>;
+
+    constexpr auto max_ngram = 8U;
+
+
+    // Maps every distinct word to a dense 32-bit id, the word itself stays in the mapping. Open addressing with
+    // 8-byte slots {32-bit hash tag, id}, so a probe only reads the word on a tag match.
+    class Vocabulary {
+        struct Slot {
+            uint32_t tag;
+            uint32_t id;        // id + 1, zero marks an empty slot
+        };
+
+        std::vector<Slot> slots;
+        std::vector<string_view> words{};
+
+        static auto hash(string_view word) -> uint64_t { return std::hash<string_view>{}(word); }
+
+        void insert_slot(uint64_t h, uint32_t id) {
+            auto const mask = slots.size() - 1;
+            auto k = static_cast<size_t>(h) & mask;
+            while (slots[k].id != 0) k = (k + 1) & mask;
+            slots[k] = Slot{static_cast<uint32_t>(h >> 32), id + 1};
+        }
+
+        void grow() {
+            slots = std::vector<Slot>(slots.size() * 2);
+            for (auto id = 0U; id < words.size(); ++id) insert_slot(hash(words[id]), id);
+        }
+
+    public:
+        explicit Vocabulary(size_t capacity) : slots(std::bit_ceil(std::max(capacity * 2, 1024UL))) {
+            words.reserve(capacity);
+        }
+
+        auto id_of(string_view word) -> uint32_t {
+            auto const h = hash(word);
+            auto const tag = static_cast<uint32_t>(h >> 32);
+            auto const mask = slots.size() - 1;
+            auto k = static_cast<size_t>(h) & mask;
+            for (; slots[k].id != 0; k = (k + 1) & mask) {
+                if (slots[k].tag == tag && words[slots[k].id - 1] == word) return slots[k].id - 1;
+            }
+
+            auto const id = static_cast<uint32_t>(words.size());
+            words.push_back(word);
+            if (words.size() * 2 > slots.size()) grow();
+            else slots[k] = Slot{tag, id + 1};
+            return id;
+        }
+
+        [[nodiscard]] auto size() const -> size_t { return words.size(); }
+
+        [[nodiscard]] auto word(uint32_t id) const -> string_view { return words[id]; }
+    };
+
+    // Counts n-grams in an open-addressing table of cells {count, N word ids}: the packed key is compared
+    // in place, so a probe reads a single cache line and no phrase string is built or hashed.
+    // Cells are padded to a power of two words, so none of them straddles two cache lines.
+    class NGramTable {
+        unsigned N;
+        size_t stride;
+        std::vector<uint32_t> cells;    // a zero count marks an empty cell
+        size_t num_cells;
+        size_t num_grams = 0;
+
+        auto cell(size_t k) -> uint32_t* { return cells.data() + k * stride; }
+
+        auto cell(size_t k) const -> uint32_t const* { return cells.data() + k * stride; }
+
+        void grow() {
+            auto old = std::move(cells);
+            auto const old_cells = num_cells;
+            num_cells *= 2;
+            cells = std::vector<uint32_t>(num_cells * stride);
+            auto const mask = num_cells - 1;
+            for (auto j = 0UL; j < old_cells; ++j) {
+                auto from = old.data() + j * stride;
+                if (from[0] == 0) continue;
+                auto k = static_cast<size_t>(hash(std::span<uint32_t const>{from + 1, N})) & mask;
+                while (cell(k)[0] != 0) k = (k + 1) & mask;
+                std::copy_n(from, N + 1, cell(k));
+            }
+        }
+
+    public:
+        template<size_t Extent>
+        static auto hash(std::span<uint32_t const, Extent> gram) -> uint64_t {
+            auto h = 0x9E3779B97F4A7C15ULL;
+            for (auto id: gram) {
+                h ^= id;
+                h *= 0xFF51AFD7ED558CCDULL;
+                h ^= h >> 32;
+            }
+            return h;
+        }
+
+        NGramTable(unsigned N_, size_t capacity)
+            : N(N_), stride(std::bit_ceil(N_ + 1UL)), num_cells(std::bit_ceil(std::max(capacity + capacity / 3, 1024UL))) {
+            cells = std::vector<uint32_t>(num_cells * stride);
+        }
+
+        // Starts loading the cell a gram of this hash probes first, see add().
+        void prefetch(uint64_t h) const { __builtin_prefetch(cell(static_cast<size_t>(h) & (num_cells - 1)), 1); }
+
+        // h must be hash(gram); a gram of static extent gets a compare and copy of constant length
+        template<size_t Extent>
+        void add(std::span<uint32_t const, Extent> gram, uint64_t h) {
+            auto const mask = num_cells - 1;
+            for (auto k = static_cast<size_t>(h) & mask;; k = (k + 1) & mask) {
+                auto c = cell(k);
+                if (c[0] == 0) {
+                    c[0] = 1;
+                    std::copy(gram.begin(), gram.end(), c + 1);
+                    if (++num_grams * 4 > num_cells * 3) grow();
+                    return;
+                }
+                if (std::equal(gram.begin(), gram.end(), c + 1)) {
+                    ++c[0];
+                    return;
+                }
+            }
+        }
+
+        [[nodiscard]] auto size() const -> size_t { return num_grams; }
+
+        // Cell numbers run 0..capacity(), count() is zero for an empty cell.
+        [[nodiscard]] auto capacity() const -> size_t { return num_cells; }
+
+        [[nodiscard]] auto count(size_t k) const -> unsigned { return cell(k)[0]; }
+
+        [[nodiscard]] auto gram(size_t k) const -> std::span<uint32_t const> { return std::span{cell(k) + 1, N}; }
+    };
+
+    // Interns every token and counts the n-gram ending at it, with N as a constant of the loop.
+    // Distinct n-grams outnumber distinct words by far, so most table probes miss the cache; the n-grams are
+    // hashed and their cells prefetched a batch ahead, so these misses overlap instead of stalling one by one.
+    WORDCOUNT_KERNEL
+    void count_ngrams(std::span<char> text, unsigned min_length, Vocabulary& vocabulary, NGramTable& grams, unsigned N) {
+        auto run = [&]<size_t Size>() {
+            using Gram = std::array<uint32_t, Size>;
+            constexpr auto batch_size = 32UL;
+            auto pending = std::array<Gram, batch_size>{};
+            auto hashes = std::array<uint64_t, batch_size>{};
+            auto num_pending = 0UL;
+            auto flush = [&] {
+                for (auto k = 0UL; k < num_pending; ++k) grams.add(std::span<uint32_t const, Size>{pending[k]}, hashes[k]);
+                num_pending = 0;
+            };
+
+            // the Size most recent word ids, oldest first
+            auto window = Gram{};
+            auto num_tokens = 0ULL;
+            for (auto it = WordIterator{text, min_length}; it != WordIterator{}; ++it) {
+                std::shift_left(window.begin(), window.end(), 1);
+                window.back() = vocabulary.id_of(*it);
+                if (++num_tokens < Size) continue;
+
+                pending[num_pending] = window;
+                hashes[num_pending] = NGramTable::hash(std::span<uint32_t const, Size>{window});
+                grams.prefetch(hashes[num_pending]);
+                if (++num_pending == batch_size) flush();
+            }
+            flush();
+        };
+        static_assert(max_ngram == 8U);
+        switch (N) {
+            case 1: return run.template operator()<1>();
+            case 2: return run.template operator()<2>();
+            case 3: return run.template operator()<3>();
+            case 4: return run.template operator()<4>();
+            case 5: return run.template operator()<5>();
+            case 6: return run.template operator()<6>();
+            case 7: return run.template operator()<7>();
+            case 8: return run.template operator()<8>();
+            default: throw std::invalid_argument{std::format("--ngram must be 1..{}", max_ngram)};
+        }
+    }
+
+    auto run(Params const& params, Statistics& stats) -> string {
+        auto const N = params.ngram;
+        if (N < 1 || N > max_ngram) throw std::invalid_argument{std::format("--ngram must be 1..{}", max_ngram)};
+
+        // --- loading n-grams ---
+        auto file = MemoryMappedFile{params.filename};
+        auto estimator = VocabularyEstimator{params.min_length, file.data().size(), N};
+        estimator.sample(file.data());
+        stats.estimated_unique_words = estimator.estimate();
+        auto vocabulary = Vocabulary{stats.estimated_unique_words};
+        auto grams = NGramTable{N, N == 1 ? stats.estimated_unique_words : estimator.estimate_ngrams()};
+
+        kernels::fold_to_lower(file.data());
+        count_ngrams(file.data(), params.min_length, vocabulary, grams, N);
+        stats.unique_words = vocabulary.size();
+        stats.unique_ngrams = grams.size();
+
+
+        // --- sorting <n-gram,count> pairs ---
+        // <count, cell> pairs, so the sort compares in place instead of reading the table at random
+        auto entries = std::vector<std::pair<unsigned, size_t>>{};
+        entries.reserve(grams.size());
+        for (auto k = 0UL; k < grams.capacity(); ++k) {
+            if (auto count = grams.count(k); count > 0) entries.emplace_back(count, k);
+        }
+        auto by_freq_desc = [](auto const& a, auto const& b) { return a.first > b.first; };
+        auto const M = std::min<size_t>(params.max_words, entries.size());
+        r::partial_sort(entries, entries.begin() + M, by_freq_desc);
+        entries.resize(M);
+
+        auto sortable = std::vector<WordFreq>{};
+        sortable.reserve(M);
+        for (auto [count, cell]: entries) {
+            auto phrase = string{};
+            for (auto id: grams.gram(cell)) {
+                if (not phrase.empty()) phrase += ' ';
+                phrase += vocabulary.word(id);
+            }
+            sortable.emplace_back(std::move(phrase), count);
+        }
+
+
+        // --- making html span tags ---
+        auto phrases = std::vector<std::pair<string_view, unsigned>>(sortable.begin(), sortable.end());
+        auto cloud = WordCloud{params};
+        auto html = cloud.head(std::format("The {} most frequent {}-grams in {}", params.max_words, N, params.filename.string()));
+        html += cloud.spans(phrases, "phrase");
+        html += WordCloud::tail();
+
+        return html;
+    }
+
+    auto run(Params const& params) -> string {
+        auto stats = Statistics{};
+        return run(params, stats);
+    }
+}
@@ -1,11 +1,20 @@
 #pragma once
 #include <filesystem>
+#include <fstream>
 #include <string>
+#include <vector>
+#include <span>
+#include <stdexcept>
+#include <algorithm>
+
+#include "token-class.hxx"
 
 namespace ribomation::wordcount {
     namespace fs = std::filesystem;
     using namespace std::string_literals;
 
+    enum class Compression { none, gzip, zstd };
+
     struct Params {
         fs::path basedir = fs::path{"../.."};
         fs::path filename = basedir / fs::path{"data/shakespeare.txt"};
@@ -13,6 +22,26 @@ namespace ribomation::wordcount {
         unsigned max_words = 100U;
         unsigned max_font = 200U;
         unsigned min_font = 40U;
+        unsigned workers = 0U;
+        unsigned ngram = 1U;
+        std::string engine = "auto"s;
+        fs::path dump_file{};
+        std::string dump_format = "csv"s;
+        unsigned window_seconds = 300U;
+        unsigned window_mb = 0U;
+        unsigned interval_ms = 1000U;
+        std::string format = "html"s;
+        Compression compression = Compression::none;
+        std::string context_word{};
+        unsigned context_width = 40U;
+        unsigned max_contexts = 50U;
+        std::string prefix{};
+        std::vector<unsigned> min_lengths{};
+        std::vector<unsigned> max_words_list{};
+        fs::path file_list{};
+        fs::path cache_dir{};
+        unsigned cache_mb = 256U;
+        std::string token_chars{default_token_chars};
 
         void parse(int argc, char* argv[]) {
             for (auto k = 1; k < argc; ++k) {
@@ -23,8 +52,90 @@ namespace ribomation::wordcount {
                     min_length = std::stoul(argv[++k]);
                 } else if (arg == "--max"s) {
                     max_words = std::stoul(argv[++k]);
+                } else if (arg == "--workers"s) {
+                    workers = std::stoul(argv[++k]);
+                } else if (arg == "--ngram"s) {
+                    ngram = std::stoul(argv[++k]);
+                } else if (arg == "--dump"s) {
+                    dump_file = fs::path{argv[++k]};
+                } else if (arg == "--dump-format"s) {
+                    dump_format = argv[++k];
+                    if (dump_format != "csv"s && dump_format != "bin"s)
+                        throw std::invalid_argument{"unknown dump format "s + dump_format + ", use csv or bin"s};
+                } else if (arg == "--window-sec"s) {
+                    window_seconds = std::stoul(argv[++k]);
+                } else if (arg == "--window-mb"s) {
+                    window_mb = std::stoul(argv[++k]);
+                } else if (arg == "--interval-ms"s) {
+                    interval_ms = std::stoul(argv[++k]);
+                } else if (arg == "--format"s) {
+                    format = argv[++k];
+                } else if (arg == "--contexts"s) {
+                    context_word = argv[++k];
+                } else if (arg == "--context-width"s) {
+                    context_width = std::stoul(argv[++k]);
+                } else if (arg == "--prefix"s) {
+                    prefix = argv[++k];
+                } else if (arg == "--min-list"s) {
+                    min_lengths = parse_list(argv[++k]);
+                } else if (arg == "--max-list"s) {
+                    max_words_list = parse_list(argv[++k]);
+                } else if (arg == "--file-list"s) {
+                    file_list = fs::path{argv[++k]};
+                } else if (arg == "--cache-dir"s) {
+                    cache_dir = fs::path{argv[++k]};
+                } else if (arg == "--cache-mb"s) {
+                    cache_mb = std::stoul(argv[++k]);
+                } else if (arg == "--token-chars"s) {
+                    token_chars = argv[++k];
+                } else if (arg == "--token-spec"s) {
+                    token_chars = TokenClass::preset(argv[++k]);
+                } else if (arg == "--engine"s) {
+                    engine = argv[++k];
                 }
             }
+            compression = detect_compression(filename);
+        }
+
+        // The input as named on the command line, --file-list when given, else the file or directory of --file.
+        [[nodiscard]] auto input() const -> fs::path const& { return file_list.empty() ? filename : file_list; }
+
+        // Comma-separated numbers and inclusive ranges, e.g. "3..6,8,10".
+        static auto parse_list(std::string const& spec) -> std::vector<unsigned> {
+            auto values = std::vector<unsigned>{};
+            for (auto start = 0UL; start <= spec.size();) {
+                auto end = std::min(spec.find(',', start), spec.size());
+                auto item = spec.substr(start, end - start);
+                if (auto dots = item.find(".."); dots != std::string::npos) {
+                    auto first = std::stoul(item.substr(0, dots));
+                    auto last = std::stoul(item.substr(dots + 2));
+                    if (first > last) throw std::invalid_argument{"empty range "s + item};
+                    for (auto value = first; value <= last; ++value) values.push_back(static_cast<unsigned>(value));
+                } else {
+                    values.push_back(static_cast<unsigned>(std::stoul(item)));
+                }
+                start = end + 1;
+            }
+            return values;
+        }
+
+        // By magic bytes, gzip 1F 8B and zstd 28 B5 2F FD, of the first bytes of the input.
+        static auto compression_of(std::span<unsigned char const> head) -> Compression {
+            if (head.size() >= 2 && head[0] == 0x1F && head[1] == 0x8B) return Compression::gzip;
+            if (head.size() >= 4 && head[0] == 0x28 && head[1] == 0xB5 && head[2] == 0x2F && head[3] == 0xFD) return Compression::zstd;
+            return Compression::none;
+        }
+
+        // Only a regular file is sniffed: reading ahead would consume input of a pipe or /dev/stdin, and block on
+        // a FIFO without a writer. The compressed engine detects the format of such a stream itself.
+        // A missing or unreadable file is left to the engine.
+        static auto detect_compression(fs::path const& file) -> Compression {
+            auto ec = std::error_code{};
+            if (not fs::is_regular_file(file, ec)) return Compression::none;
+            unsigned char magic[4]{};
+            auto in = std::ifstream{file, std::ios::binary};
+            if (not in.read(reinterpret_cast<char*>(magic), sizeof(magic))) return Compression::none;
+            return compression_of(magic);
         }
     };
 
@@ -0,0 +1,74 @@
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <vector>
+#include <ranges>
+#include <algorithm>
+
+#include "params.hxx"
+#include "word-cloud.hxx"
+#include "statistics.hxx"
+#include "mem-map-file.hxx"
+#include "adaptive-radix-tree.hxx"
+#include "ranked-dump.hxx"
+#include "kernels.hxx"
+
+
+namespace ribomation::wordcount::radix_tree {
+    namespace fs = std::filesystem;
+    namespace r = std::ranges;
+    using namespace std::string_literals;
+    using std::string;
+    using std::string_view;
+    using mem_map::MemoryMappedFile;
+    using mem_map::WordIterator;
+    using WordFreq = std::pair<string_view, unsigned>;
+
+
+    auto run(Params const& params, Statistics& stats) -> string {
+        // --- loading words ---
+        auto file = MemoryMappedFile{params.filename};
+        auto tree = AdaptiveRadixTree{};
+
+        kernels::fold_to_lower(file.data());
+        auto first = WordIterator{file.data(), params.min_length};
+        auto last = WordIterator{};
+        r::for_each(r::subrange{first, last}, [&tree](string_view word) {
+            tree.insert(word);
+        });
+        stats.unique_words = tree.size();
+
+
+        // --- the whole vocabulary ranked by frequency, as every engine dumps it ---
+        if (not params.dump_file.empty()) {
+            auto vocabulary = std::vector<RankedWord>{};
+            vocabulary.reserve(tree.size());
+            tree.for_each([&vocabulary](string_view word, unsigned count) { vocabulary.emplace_back(word, count); });
+            rank_by_frequency(vocabulary);
+            dump_ranked(params.dump_file, params.dump_format, vocabulary);
+        }
+
+
+        // --- selecting the top <word,count> pairs with the prefix ---
+        auto prefix = params.prefix;
+        kernels::fold_to_lower(prefix);
+        auto sortable = tree.top(prefix, params.max_words);
+
+
+        // --- making html span tags ---
+        auto cloud = WordCloud{params};
+        auto html = cloud.head(prefix.empty()
+                ? std::format("The {} most frequent words in {}", params.max_words, params.filename.string())
+                : std::format("The {} most frequent words starting with '{}' in {}",
+                              params.max_words, prefix, params.filename.string()));
+        html += cloud.spans(sortable);
+        html += WordCloud::tail();
+
+        return html;
+    }
+
+    auto run(Params const& params) -> string {
+        auto stats = Statistics{};
+        return run(params, stats);
+    }
+}
@@ -0,0 +1,189 @@
+#include <string>
+#include <string_view>
+#include <span>
+#include <vector>
+#include <array>
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "ranked-dump.hxx"
+
+namespace ribomation::wordcount {
+    using namespace std::string_literals;
+    using std::string_view;
+    using std::span;
+
+    namespace {
+        // Frequencies below this get a counting-sort bucket, the few words above are compared.
+        constexpr auto max_bucket_freq = 1U << 16;
+
+        // Below this size a radix pass costs more than it saves.
+        constexpr auto radix_cutoff = 32UL;
+
+        auto byte_at(string_view word, size_t depth) -> unsigned {
+            return depth < word.size() ? static_cast<unsigned char>(word[depth]) + 1U : 0U;
+        }
+
+        // MSD radix sort of words sharing their first depth bytes, bucket 0 holds the words that end there.
+        void radix_sort_words(span<RankedWord> words, span<RankedWord> scratch, size_t depth) {
+            if (words.size() < radix_cutoff) {
+                std::ranges::sort(words, [](RankedWord const& a, RankedWord const& b) { return a.first < b.first; });
+                return;
+            }
+
+            auto counts = std::array<size_t, 258>{};
+            for (auto const& w: words) ++counts[byte_at(w.first, depth) + 1];
+            for (auto k = 1UL; k < counts.size(); ++k) counts[k] += counts[k - 1];
+
+            auto next = counts;
+            for (auto const& w: words) scratch[next[byte_at(w.first, depth)]++] = w;
+            std::ranges::copy(scratch.first(words.size()), words.begin());
+
+            for (auto b = 1UL; b < 257; ++b) {
+                auto first = counts[b], last = counts[b + 1];
+                if (last - first > 1) radix_sort_words(words.subspan(first, last - first), scratch, depth + 1);
+            }
+        }
+
+        class BufferedWriter {
+            int fd;
+            std::vector<char> buffer;
+            size_t used = 0;
+
+        public:
+            explicit BufferedWriter(fs::path const& filename, size_t capacity = 1024 * 1024) : buffer(capacity) {
+                fd = open(filename.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                if (fd == -1) throw std::runtime_error{"cannot open outfile "s + filename.string()};
+            }
+
+            ~BufferedWriter() {
+                if (fd != -1) close(fd);
+            }
+
+            BufferedWriter(BufferedWriter const&) = delete;
+            BufferedWriter& operator=(BufferedWriter const&) = delete;
+
+            void write(string_view chunk) {
+                if (used + chunk.size() > buffer.size()) flush();
+                if (chunk.size() > buffer.size()) {
+                    write_fully(chunk);
+                    return;
+                }
+                std::memcpy(buffer.data() + used, chunk.data(), chunk.size());
+                used += chunk.size();
+            }
+
+            template<typename Number>
+            void write_number(Number value) {
+                char digits[24];
+                auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), value);
+                write(string_view{digits, static_cast<size_t>(end - digits)});
+            }
+
+            template<typename Number>
+            void write_binary(Number value) {
+                write(string_view{reinterpret_cast<char const*>(&value), sizeof(value)});
+            }
+
+            void flush() {
+                write_fully(string_view{buffer.data(), used});
+                used = 0;
+            }
+
+        private:
+            void write_fully(string_view chunk) {
+                while (not chunk.empty()) {
+                    auto n = ::write(fd, chunk.data(), chunk.size());
+                    if (n == -1 && errno == EINTR) continue;
+                    if (n == -1) throw std::runtime_error{"write failed: "s + strerror(errno)};
+                    chunk.remove_prefix(static_cast<size_t>(n));
+                }
+            }
+        };
+    }
+
+    void rank_by_frequency(std::vector<RankedWord>& words) {
+        // --- counting sort by descending frequency, frequent words go to a separate, compared, head ---
+        auto counts = std::vector<size_t>(max_bucket_freq + 1);
+        auto num_heavy = 0UL;
+        for (auto const& w: words) {
+            if (w.second >= max_bucket_freq) ++num_heavy;
+            else ++counts[w.second];
+        }
+
+        auto starts = std::vector<size_t>(max_bucket_freq + 1);
+        auto position = num_heavy;
+        for (auto freq = max_bucket_freq; freq-- > 0;) {
+            starts[freq] = position;
+            position += counts[freq];
+        }
+
+        auto ranked = std::vector<RankedWord>(words.size());
+        auto next = starts;
+        auto heavy = 0UL;
+        for (auto const& w: words) {
+            if (w.second >= max_bucket_freq) ranked[heavy++] = w;
+            else ranked[next[w.second]++] = w;
+        }
+
+        // --- ties broken by word ---
+        auto head = span{ranked}.first(num_heavy);
+        std::ranges::sort(head, [](RankedWord const& a, RankedWord const& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+        auto scratch = std::vector<RankedWord>(words.size());
+        for (auto freq = 0U; freq < max_bucket_freq; ++freq) {
+            if (counts[freq] > 1) radix_sort_words(span{ranked}.subspan(starts[freq], counts[freq]), scratch, 0);
+        }
+
+        words = std::move(ranked);
+    }
+
+    auto csv_field(string_view text) -> std::string {
+        if (text.find_first_of(",\"\r\n") == string_view::npos) return std::string{text};
+        auto field = "\""s;
+        for (auto ch: text) {
+            if (ch == '"') field += '"';
+            field += ch;
+        }
+        field += '"';
+        return field;
+    }
+
+    void dump_ranked(fs::path const& filename, std::string const& format, span<RankedWord const> words) {
+        auto out = BufferedWriter{filename};
+        if (format == "csv"s) {
+            out.write("rank,word,count\n");
+            auto rank = 0UL;
+            for (auto const& [word, count]: words) {
+                out.write_number(++rank);
+                out.write(",");
+                if (word.find_first_of(",\"\r\n") == string_view::npos) out.write(word);
+                else out.write(csv_field(word));
+                out.write(",");
+                out.write_number(count);
+                out.write("\n");
+            }
+        } else if (format == "bin"s) {
+            out.write(string_view{"WCRANK1\0", 8});
+            out.write_binary(static_cast<uint64_t>(words.size()));
+            for (auto const& [word, count]: words) {
+                out.write_binary(static_cast<uint32_t>(count));
+                out.write_binary(static_cast<uint32_t>(word.size()));
+                out.write(word);
+            }
+        } else {
+            throw std::invalid_argument{"unknown dump format "s + format};
+        }
+        out.flush();
+    }
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <span>
+#include <vector>
+#include <filesystem>
+#include <utility>
+
+namespace ribomation::wordcount {
+    namespace fs = std::filesystem;
+
+    using RankedWord = std::pair<std::string_view, unsigned>;
+
+    // Orders all words by descending frequency, ties by ascending word, in linear time:
+    // a counting sort over the (mostly tiny) frequencies, then an MSD radix sort of the words inside each frequency.
+    void rank_by_frequency(std::vector<RankedWord>& words);
+
+    // A CSV field as of RFC 4180, quoted if it holds a comma, quote or line break, inner quotes doubled.
+    // Paths and, with --token-chars, words may hold any of them.
+    auto csv_field(std::string_view text) -> std::string;
+
+    // Writes the ranked words as "rank,word,count" CSV lines (words quoted by csv_field) or, for format "bin", as
+    // "WCRANK1\0", uint64 N, then N records of {uint32 count, uint32 length, length chars} (host byte order).
+    void dump_ranked(fs::path const& filename, std::string const& format, std::span<RankedWord const> words);
+
+}
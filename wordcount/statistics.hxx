@@ -0,0 +1,14 @@
+#pragma once
+#include <cstddef>
+
+namespace ribomation::wordcount {
+
+    struct Statistics {
+        size_t estimated_unique_words = 0;
+        size_t unique_words = 0;
+        size_t unique_ngrams = 0;
+        size_t chunks = 0;
+        size_t cached_chunks = 0;
+    };
+
+}
@@ -0,0 +1,304 @@
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include <ranges>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <cmath>
+#include <cstdint>
+
+#include "params.hxx"
+#include "word-cloud.hxx"
+#include "statistics.hxx"
+#include "mem-map-file.hxx"
+#include "compact-table.hxx"
+#include "kernels.hxx"
+#include "ranked-dump.hxx"
+
+
+namespace ribomation::wordcount::tfidf {
+    namespace fs = std::filesystem;
+    namespace r = std::ranges;
+    using namespace std::string_literals;
+    using std::string;
+    using std::string_view;
+    using mem_map::MemoryMappedFile;
+    using mem_map::WordIterator;
+    using WordScore = std::pair<string_view, double>;
+
+    // Top words shown per document, and the number of document sections in the html page.
+    constexpr auto doc_top_k = 10U;
+    constexpr auto max_doc_sections = 1000U;
+
+
+    // The documents: every regular file below a directory, or the paths listed one per line in a file.
+    auto collection(Params const& params) -> std::vector<fs::path> {
+        auto documents = std::vector<fs::path>{};
+        if (not params.file_list.empty()) {
+            auto list = std::ifstream{params.file_list};
+            if (not list) throw std::invalid_argument{"cannot open "s + params.file_list.string()};
+            for (auto line = string{}; std::getline(list, line);) {
+                if (not line.empty()) documents.emplace_back(line);
+            }
+        } else {
+            if (not fs::is_directory(params.filename))
+                throw std::invalid_argument{"not a directory: "s + params.filename.string()};
+            for (auto const& entry: fs::recursive_directory_iterator{params.filename}) {
+                if (entry.is_regular_file()) documents.push_back(entry.path());
+            }
+            r::sort(documents);
+        }
+        if (documents.empty()) throw std::invalid_argument{"no documents in "s + params.input().string()};
+        return documents;
+    }
+
+    // Word to term id, shared by all counting threads. Sharded by hash, so a document merges its words
+    // shard by shard under one lock each. Words are copied in, the documents' mappings do not outlive their merge.
+    class SharedVocabulary {
+        static constexpr auto num_shards = 64U;
+
+        struct Hash {
+            using is_transparent = void;
+            auto operator()(string_view word) const -> size_t { return std::hash<string_view>{}(word); }
+        };
+
+        struct Shard {
+            std::mutex lock{};
+            std::unordered_map<string, uint32_t, Hash, std::equal_to<>> ids{};
+        };
+
+        std::array<Shard, num_shards> shards{};
+        std::atomic<uint32_t> next_id{0};
+
+    public:
+        static auto shard_of(string_view word) -> unsigned {
+            return static_cast<unsigned>(Hash{}(word) >> 58);
+        }
+
+        // Replaces the word of every entry in one shard's batch by its term id.
+        template<typename Entry>
+        void resolve(unsigned shard, std::span<Entry> batch) {
+            auto& s = shards[shard];
+            auto guard = std::lock_guard{s.lock};
+            for (auto& entry: batch) {
+                auto it = s.ids.find(entry.word);
+                if (it == s.ids.end()) it = s.ids.emplace(string{entry.word}, next_id++).first;
+                entry.term = it->second;
+            }
+        }
+
+        [[nodiscard]] auto size() const -> uint32_t { return next_id; }
+
+        // Term id to word, once all documents are merged.
+        [[nodiscard]] auto words() const -> std::vector<string_view> {
+            auto result = std::vector<string_view>(size());
+            for (auto const& s: shards) {
+                for (auto const& [word, id]: s.ids) result[id] = word;
+            }
+            return result;
+        }
+    };
+
+    // Term-document counts in compressed sparse row form: row d spans [row_offsets[d], row_offsets[d+1])
+    // of term_ids and counts, sorted by term id.
+    struct TermDocumentMatrix {
+        std::vector<uint64_t> row_offsets{};
+        std::vector<uint32_t> term_ids{};
+        std::vector<uint32_t> counts{};
+        std::vector<uint64_t> doc_lengths{};    // number of words counted in each document
+
+        [[nodiscard]] auto num_docs() const -> size_t { return doc_lengths.size(); }
+    };
+
+    // Counts the documents in parallel. Each row is appended unordered as its document completes and
+    // the matrix is put into document order at the end.
+    auto count_documents(Params const& params, std::vector<fs::path> const& documents,
+                         SharedVocabulary& vocabulary) -> TermDocumentMatrix {
+        struct Entry {
+            string_view word;
+            uint32_t count;
+            uint32_t term;
+        };
+        struct Row {
+            uint64_t start = 0, length = 0;
+        };
+
+        auto rows = std::vector<Row>(documents.size());
+        auto doc_lengths = std::vector<uint64_t>(documents.size());
+        auto term_ids = std::vector<uint32_t>{};
+        auto counts = std::vector<uint32_t>{};
+        auto append_lock = std::mutex{};
+
+        auto next = std::atomic<size_t>{0};
+        auto errors = std::vector<std::exception_ptr>(documents.size());
+        auto worker = [&] {
+            auto entries = std::vector<Entry>{};
+            for (auto doc = next++; doc < documents.size(); doc = next++) {
+                try {
+                    if (fs::file_size(documents[doc]) == 0) continue;
+                    auto file = MemoryMappedFile{documents[doc]};
+                    kernels::fold_to_lower(file.data());
+                    file.freeze();
+
+                    auto freqs = CompactWordTable{file.data(), 0};
+                    for (auto it = WordIterator{file.data(), params.min_length}; it != WordIterator{}; ++it) {
+                        freqs.add(*it);
+                        ++doc_lengths[doc];
+                    }
+
+                    entries.clear();
+                    freqs.for_each([&entries](string_view word, unsigned count) {
+                        entries.push_back(Entry{word, count, 0});
+                    });
+                    r::sort(entries, {}, [](Entry const& e) { return SharedVocabulary::shard_of(e.word); });
+                    for (auto first = entries.begin(); first != entries.end();) {
+                        auto shard = SharedVocabulary::shard_of(first->word);
+                        auto last = std::find_if(first, entries.end(),
+                                                 [shard](Entry const& e) { return SharedVocabulary::shard_of(e.word) != shard; });
+                        vocabulary.resolve(shard, std::span{first, last});
+                        first = last;
+                    }
+                    r::sort(entries, {}, &Entry::term);
+
+                    auto guard = std::lock_guard{append_lock};
+                    rows[doc] = Row{term_ids.size(), entries.size()};
+                    for (auto const& e: entries) {
+                        term_ids.push_back(e.term);
+                        counts.push_back(e.count);
+                    }
+                } catch (...) {
+                    errors[doc] = std::current_exception();
+                }
+            }
+        };
+        {
+            auto const num_threads = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, documents.size());
+            auto threads = std::vector<std::jthread>{};
+            for (auto k = 0UL; k < num_threads; ++k) threads.emplace_back(worker);
+        }
+        for (auto const& error: errors) {
+            if (error) std::rethrow_exception(error);
+        }
+
+        auto matrix = TermDocumentMatrix{};
+        matrix.row_offsets.reserve(documents.size() + 1);
+        matrix.term_ids.reserve(term_ids.size());
+        matrix.counts.reserve(counts.size());
+        matrix.row_offsets.push_back(0);
+        for (auto const& row: rows) {
+            matrix.term_ids.insert(matrix.term_ids.end(), term_ids.begin() + row.start, term_ids.begin() + row.start + row.length);
+            matrix.counts.insert(matrix.counts.end(), counts.begin() + row.start, counts.begin() + row.start + row.length);
+            matrix.row_offsets.push_back(matrix.term_ids.size());
+        }
+        matrix.doc_lengths = std::move(doc_lengths);
+        return matrix;
+    }
+
+    // tf-idf(t,d) = count(t,d) / |d| * log(N / df(t))
+    class Scores {
+        TermDocumentMatrix const& matrix;
+        std::vector<double> idf;
+
+    public:
+        Scores(TermDocumentMatrix const& matrix_, size_t num_terms) : matrix(matrix_), idf(num_terms) {
+            auto df = std::vector<uint32_t>(num_terms);
+            for (auto term: matrix.term_ids) ++df[term];
+            auto const N = static_cast<double>(matrix.num_docs());
+            for (auto t = 0UL; t < num_terms; ++t) idf[t] = df[t] > 0 ? std::log(N / df[t]) : 0.0;
+        }
+
+        [[nodiscard]] auto score(size_t doc, uint64_t entry) const -> double {
+            return static_cast<double>(matrix.counts[entry]) / static_cast<double>(matrix.doc_lengths[doc])
+                   * idf[matrix.term_ids[entry]];
+        }
+
+        // The K highest-scoring terms of one document.
+        [[nodiscard]] auto top(size_t doc, unsigned K, std::vector<string_view> const& words) const -> std::vector<WordScore> {
+            auto result = std::vector<WordScore>{};
+            for (auto e = matrix.row_offsets[doc]; e < matrix.row_offsets[doc + 1]; ++e) {
+                result.emplace_back(words[matrix.term_ids[e]], score(doc, e));
+            }
+            auto const N = std::min<size_t>(K, result.size());
+            r::partial_sort(result, result.begin() + N, [](auto const& a, auto const& b) { return a.second > b.second; });
+            result.resize(N);
+            return result;
+        }
+
+        // The K terms with the highest tf-idf summed over all documents.
+        [[nodiscard]] auto top(unsigned K, std::vector<string_view> const& words) const -> std::vector<WordScore> {
+            auto total = std::vector<double>(words.size());
+            for (auto doc = 0UL; doc < matrix.num_docs(); ++doc) {
+                for (auto e = matrix.row_offsets[doc]; e < matrix.row_offsets[doc + 1]; ++e) {
+                    total[matrix.term_ids[e]] += score(doc, e);
+                }
+            }
+            auto result = std::vector<WordScore>{};
+            result.reserve(words.size());
+            for (auto t = 0UL; t < words.size(); ++t) result.emplace_back(words[t], total[t]);
+            auto const N = std::min<size_t>(K, result.size());
+            r::partial_sort(result, result.begin() + N, [](auto const& a, auto const& b) { return a.second > b.second; });
+            result.resize(N);
+            return result;
+        }
+    };
+
+    auto run(Params const& params, Statistics& stats) -> string {
+        // --- counting every document into the shared vocabulary ---
+        auto documents = collection(params);
+        auto vocabulary = SharedVocabulary{};
+        auto matrix = count_documents(params, documents, vocabulary);
+        auto words = vocabulary.words();
+        stats.unique_words = words.size();
+
+
+        // --- ranking by tf-idf ---
+        auto scores = Scores{matrix, words.size()};
+        auto corpus_top = scores.top(params.max_words, words);
+
+        if (not params.dump_file.empty()) {
+            auto out = std::ofstream{params.dump_file};
+            if (not out) throw std::runtime_error{"cannot open "s + params.dump_file.string()};
+            out << "document,rank,word,tfidf\n";
+            for (auto doc = 0UL; doc < documents.size(); ++doc) {
+                auto rank = 0U;
+                for (auto const& [word, score]: scores.top(doc, params.max_words, words)) {
+                    out << std::format("{},{},{},{:.6g}\n", csv_field(documents[doc].string()), ++rank, csv_field(word), score);
+                }
+            }
+            if (not out) throw std::runtime_error{"cannot write "s + params.dump_file.string()};
+        }
+
+
+        // --- making html span tags ---
+        auto cloud = WordCloud{params};
+        auto html = cloud.head(std::format("The {} most distinctive words of {} documents in {}",
+                                           params.max_words, documents.size(), params.input().string()));
+        html.reserve(500 + (corpus_top.size() * 150) + std::min<size_t>(documents.size(), max_doc_sections) * 1800);
+        html += cloud.spans(corpus_top);
+        for (auto doc = 0UL; doc < std::min<size_t>(documents.size(), max_doc_sections); ++doc) {
+            html += std::format("<h2>{}</h2>\n", html_escaped(documents[doc].string()));
+            auto top = scores.top(doc, doc_top_k, words);
+            html += cloud.spans(top);
+        }
+        if (documents.size() > max_doc_sections) {
+            html += std::format("<p>... and {} more documents, use --dump for all of them</p>\n",
+                                documents.size() - max_doc_sections);
+        }
+        html += WordCloud::tail();
+
+        return html;
+    }
+
+    auto run(Params const& params) -> string {
+        auto stats = Statistics{};
+        return run(params, stats);
+    }
+}
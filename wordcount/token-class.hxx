@@ -0,0 +1,184 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <array>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define WORDCOUNT_X86_DISPATCH
+#endif
+
+namespace ribomation::wordcount {
+    using namespace std::string_literals;
+
+    // The word characters of all steps unless --token-chars/--token-spec says otherwise
+    inline constexpr auto default_token_chars = std::string_view{"A-Za-z'"};
+
+    // The bytes that make up a word, compiled from a character set such as "A-Za-z'" or "a-z0-9_#-":
+    // single characters and inclusive ranges x-y, a '-' first or last stands for itself, '\' escapes the next one.
+    // All steps count words lower-cased, so the set is closed under ASCII case: "a-z" admits A-Z too, and every step
+    // splits the same words whether it classifies before folding, as when folding in place, or after it.
+    // Besides a 256-entry table it keeps two 16-byte nibble lookups for pshufb, where a byte belongs to the set
+    // iff low[byte & 15] & high[byte >> 4] != 0. That is exact when at most 8 distinct rows of 16 bytes (one per
+    // high nibble) occur, as for any mix of ASCII letters, digits and punctuation; other sets use the table only.
+    // The lookup runs on AVX2 or SSSE3, whichever the CPU has, picked at run-time unless the build targets it.
+    class TokenClass {
+        std::array<bool, 256> table{};
+        std::array<uint8_t, 16> low_nibbles{};
+        std::array<uint8_t, 16> high_nibbles{};
+        bool nibble_exact = true;
+
+        enum class Isa { scalar, ssse3, avx2 };
+
+        static auto detect_isa() -> Isa {
+#if defined(__AVX2__)
+            return Isa::avx2;
+#elif defined(WORDCOUNT_X86_DISPATCH)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) return Isa::avx2;
+            if (__builtin_cpu_supports("ssse3")) return Isa::ssse3;
+            return Isa::scalar;
+#else
+            return Isa::scalar;
+#endif
+        }
+
+        static inline Isa const isa = detect_isa();
+
+        constexpr void compile_nibbles() {
+            auto rows = std::array<uint16_t, 16>{};
+            for (auto c = 0U; c < 256; ++c) {
+                if (table[c]) rows[c >> 4] |= static_cast<uint16_t>(1U << (c & 15));
+            }
+
+            auto distinct = std::array<uint16_t, 8>{};
+            auto num_distinct = 0U;
+            for (auto high = 0U; high < 16; ++high) {
+                if (rows[high] == 0) continue;
+                auto k = static_cast<unsigned>(std::find(distinct.begin(), distinct.begin() + num_distinct, rows[high]) - distinct.begin());
+                if (k == num_distinct) {
+                    if (num_distinct == distinct.size()) {
+                        nibble_exact = false;
+                        return;
+                    }
+                    distinct[num_distinct++] = rows[high];
+                }
+                high_nibbles[high] = static_cast<uint8_t>(1U << k);
+            }
+            for (auto k = 0U; k < num_distinct; ++k) {
+                for (auto low = 0U; low < 16; ++low) {
+                    if (distinct[k] & (1U << low)) low_nibbles[low] |= static_cast<uint8_t>(1U << k);
+                }
+            }
+        }
+
+#if defined(WORDCOUNT_X86_DISPATCH)
+        // the nibble lookup of 64 bytes, bit k for text[k]
+        __attribute__((target("avx2")))
+        auto classify_avx2(char const* text) const -> uint64_t {
+            auto const low = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const*>(low_nibbles.data())));
+            auto const high = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const*>(high_nibbles.data())));
+            auto const nibble = _mm256_set1_epi8(0x0F);
+            auto bits = 0ULL;
+            for (auto k = 0U; k < 64; k += 32) {
+                auto bytes = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(text + k));
+                auto lo = _mm256_shuffle_epi8(low, _mm256_and_si256(bytes, nibble));
+                auto hi = _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble));
+                auto outside = _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256());
+                bits |= static_cast<uint64_t>(~static_cast<uint32_t>(_mm256_movemask_epi8(outside))) << k;
+            }
+            return bits;
+        }
+
+        __attribute__((target("ssse3")))
+        auto classify_ssse3(char const* text) const -> uint64_t {
+            auto const low = _mm_loadu_si128(reinterpret_cast<__m128i const*>(low_nibbles.data()));
+            auto const high = _mm_loadu_si128(reinterpret_cast<__m128i const*>(high_nibbles.data()));
+            auto const nibble = _mm_set1_epi8(0x0F);
+            auto bits = 0ULL;
+            for (auto k = 0U; k < 64; k += 16) {
+                auto bytes = _mm_loadu_si128(reinterpret_cast<__m128i const*>(text + k));
+                auto lo = _mm_shuffle_epi8(low, _mm_and_si128(bytes, nibble));
+                auto hi = _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble));
+                auto outside = _mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128());
+                bits |= static_cast<uint64_t>(~_mm_movemask_epi8(outside) & 0xFFFF) << k;
+            }
+            return bits;
+        }
+#endif
+
+    public:
+        constexpr explicit TokenClass(std::string_view chars) {
+            auto next = [&chars](size_t& pos) -> unsigned char {
+                if (chars[pos] == '\\') {
+                    if (++pos == chars.size()) throw std::invalid_argument{"dangling '\\' in token chars"};
+                }
+                return static_cast<unsigned char>(chars[pos++]);
+            };
+
+            for (auto pos = 0UL; pos < chars.size();) {
+                auto first = next(pos);
+                auto last = first;
+                if (pos + 1 < chars.size() && chars[pos] == '-') {
+                    ++pos;
+                    last = next(pos);
+                    if (first > last) throw std::invalid_argument{"empty range in token chars "s + std::string{chars}};
+                }
+                for (auto c = static_cast<unsigned>(first); c <= last; ++c) table[c] = true;
+            }
+            for (auto c = 'a'; c <= 'z'; ++c) {
+                auto const upper = static_cast<unsigned char>(c - 'a' + 'A');
+                table[upper] = table[static_cast<unsigned char>(c)] = table[upper] || table[static_cast<unsigned char>(c)];
+            }
+            if (std::ranges::none_of(table, std::identity{})) throw std::invalid_argument{"no token chars given"};
+            compile_nibbles();
+        }
+
+        [[nodiscard]] constexpr bool contains(char c) const { return table[static_cast<unsigned char>(c)]; }
+
+        // true if classify() runs on the nibble lookups rather than byte by byte
+        [[nodiscard]] bool vectorized() const { return nibble_exact && isa != Isa::scalar; }
+
+        // A stable 64-bit digest of the set, FNV-1a over the table.
+        [[nodiscard]] constexpr auto fingerprint() const -> uint64_t {
+            auto h = 0xCBF29CE484222325ULL;
+            for (auto member: table) h = (h ^ static_cast<uint64_t>(member)) * 0x100000001B3ULL;
+            return h;
+        }
+
+        // Bit k is set iff text[k] belongs to the set, for the first n <= 64 bytes of text; bits n..63 are clear.
+        [[nodiscard]] auto classify(char const* text, size_t n) const -> uint64_t {
+#if defined(WORDCOUNT_X86_DISPATCH)
+            if (vectorized()) {
+                alignas(64) char padded[64];
+                if (n < 64) {
+                    std::memset(padded, 0, sizeof(padded));
+                    std::memcpy(padded, text, n);
+                    text = padded;
+                }
+                auto const bits = isa == Isa::avx2 ? classify_avx2(text) : classify_ssse3(text);
+                return n < 64 ? bits & ((1ULL << n) - 1) : bits;
+            }
+#endif
+            auto bits = 0ULL;
+            for (auto k = 0UL; k < n; ++k) bits |= static_cast<uint64_t>(contains(text[k])) << k;
+            return bits;
+        }
+
+        // Character sets by name, for --token-spec.
+        static auto preset(std::string const& name) -> std::string {
+            if (name == "letters"s) return std::string{default_token_chars};
+            if (name == "alnum"s) return "A-Za-z0-9'"s;
+            if (name == "identifiers"s) return "A-Za-z0-9_"s;
+            if (name == "hyphenated"s) return "A-Za-z'-"s;
+            if (name == "hashtags"s) return "A-Za-z0-9_#@'"s;
+            throw std::invalid_argument{"unknown token spec "s + name + ", one of letters, alnum, identifiers, hyphenated, hashtags"s};
+        }
+    };
+
+}
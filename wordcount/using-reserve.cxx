@@ -12,93 +12,29 @@
 #include <random>
 #include <cctype>
 #include "params.hxx"
+#include "word-cloud.hxx"
+#include "statistics.hxx"
+#include "hyperloglog.hxx"
+#include "word-iterator.hxx"
 
 
 namespace ribomation::wordcount::using_reserve {
 
-    class WordIterator {
-    public:
-        using iterator_category = std::input_iterator_tag;
-        using value_type = std::string;
-        using reference = const std::string&;
-        using pointer = const std::string *;
-        using difference_type = std::ptrdiff_t;
-
-        WordIterator() = default;
-
-        explicit WordIterator(std::istream& is) : input{&is} {
-            read_next();
-        }
-
-        reference operator*() const { return current_word; }
-        pointer operator->() const { return &current_word; }
-
-        WordIterator& operator++() {
-            read_next();
-            return *this;
-        }
-
-        WordIterator operator++(int) {
-            auto tmp = *this;
-            ++(*this);
-            return tmp;
-        }
-
-        friend bool operator==(WordIterator const& a, WordIterator const& b) {
-            return a.input == b.input && a.at_eof == b.at_eof;
-        }
-
-        friend bool operator!=(WordIterator const& a, WordIterator const& b) {
-            return !(a == b);
-        }
-
-    private:
-        std::istream* input{nullptr};
-        std::string current_word{};
-        bool at_eof{true};
-
-        void read_next() {
-            if (input == nullptr) {
-                at_eof = true;
-                return;
-            }
-
-            current_word.clear();
-            for (char ch; input->get(ch) && not is_letter(ch);) {}
-            if (input->gcount()) input->unget();
-
-            if (current_word.empty() && input->eof()) {
-                at_eof = true;
-                input = nullptr;
-                return;
-            }
-
-            for (char ch; input->get(ch) && is_letter(ch);) {
-                current_word.push_back(ch);
-            }
-            at_eof = false;
-        }
-
-        static bool is_letter(char c) {
-            auto ch = static_cast<unsigned char>(c);
-            return std::isalpha(ch) || ch == '\'';
-        }
-    };
+    // Words of --token-chars as they are read, the pipeline below filters and lower-cases them
+    using WordIterator = wordcount::WordIterator<std::istream, policy::Configured, policy::PreFolded, policy::KeepAll>;
 
     namespace r = std::ranges;
     namespace v = std::ranges::views;
     using std::string;
 
-    auto run(Params const& params) -> string {
+    auto run(Params const& params, Statistics& stats) -> string {
         // --- loading words ---
         auto infile = std::ifstream{params.filename};
         if (not infile) throw std::invalid_argument{"cannot open "s + params.filename.string()};
 
         auto freqs = std::unordered_map<string, unsigned>{};
-        auto filesize = fs::file_size(params.filename);
-        auto approx_total_words = filesize / 8;
-        auto approx_unique_words = approx_total_words / 4;
-        freqs.reserve(approx_unique_words);
+        stats.estimated_unique_words = estimate_unique_words(params.filename, params.min_length);
+        freqs.reserve(stats.estimated_unique_words);
 
         auto keep_nonsmall_words = [&params](string const& word) { return word.size() >= params.min_length; };
         auto to_lowercase = [](string const& word) {
@@ -124,6 +60,7 @@ namespace ribomation::wordcount::using_reserve {
         auto count_words = [&freqs](string const& word) { ++freqs[word]; };
 
         r::for_each(load_pipeline, count_words);
+        stats.unique_words = freqs.size();
 
         // --- sorting <word,count> pairs ---
         using WordFreq = std::pair<string, unsigned>;
@@ -162,7 +99,7 @@ namespace ribomation::wordcount::using_reserve {
                 : params(params_), scale(scale_), min_freq(min_freq_), R(R_) {}
 
             auto operator()(WordFreq& wf) -> string {
-                auto word = wf.first;
+                auto word = html_escaped(wf.first);
                 auto freq = wf.second;
                 auto size = static_cast<unsigned>((freq - min_freq) * scale + params.min_font);
                 auto colr = color();
@@ -189,11 +126,16 @@ namespace ribomation::wordcount::using_reserve {
                     <title>Word Frequencies</title>
                 </head>
             <body>)";
-        html += std::format("<h1>The {} most frequent words in {}</h1>", params.max_words, params.filename.string());
+        html += std::format("<h1>The {} most frequent words in {}</h1>", params.max_words, html_escaped(params.filename.string()));
         for (string const& tag: tags) html += tag + "\n";
         html += "</body></html>\n";
 
         return html;
     }
 
+    auto run(Params const& params) -> string {
+        auto stats = Statistics{};
+        return run(params, stats);
+    }
+
 }
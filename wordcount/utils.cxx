@@ -7,6 +7,8 @@
 #include <functional>
 
 #include "params.hxx"
+#include "statistics.hxx"
+#include "word-iterator.hxx"
 
 namespace fs = std::filesystem;
 namespace c = std::chrono;
@@ -14,6 +16,9 @@ using namespace std::string_literals;
 using std::cout;
 using std::string;
 using ribomation::wordcount::Params;
+using ribomation::wordcount::Statistics;
+using ribomation::wordcount::TokenClass;
+namespace policy = ribomation::wordcount::policy;
 
 void store_html(fs::path const& input_filename, string const& html_content) {
     auto html_filename = fs::path{"."} / fs::path{input_filename.stem().string() + ".html"s};
@@ -24,15 +29,29 @@ void store_html(fs::path const& input_filename, string const& html_content) {
     std::println("written: {}", html_filename.string());
 }
 
-void word_count(string const& name, Params const& params, std::function<string()> const& generate_html) {
+void word_count(string const& name, Params const& params, std::function<string(Statistics&)> const& generate_html) {
     std::println("--- WordCount - {} ---", name);
-    std::println("loading {:.1f} MB from {}", fs::file_size(params.filename) / (1024.0 * 1024), params.filename.string());
+    if (params.file_list.empty() && fs::is_regular_file(params.filename)) {
+        std::println("loading {:.1f} MB from {}", fs::file_size(params.filename) / (1024.0 * 1024), params.filename.string());
+    } else {
+        std::println("loading from {}", params.input().string());
+    }
 
+    policy::Configured::use(TokenClass{params.token_chars});
+    auto stats = Statistics{};
     auto start = c::high_resolution_clock::now();
-    auto html = generate_html();
+    auto html = generate_html(stats);
     auto stop = c::high_resolution_clock::now();
     auto elapsed_time = c::duration_cast<c::milliseconds>(stop - start);
 
-    store_html(params.filename, html);
+    store_html(params.input(), html);
+    if (stats.estimated_unique_words > 0) std::println("estimated unique words: {}", stats.estimated_unique_words);
+    if (stats.unique_words > 0) std::println("unique words: {}", stats.unique_words);
+    if (stats.unique_ngrams > 0) std::println("unique n-grams: {}", stats.unique_ngrams);
+    if (stats.chunks > 0) std::println("chunks: {}, from cache: {}", stats.chunks, stats.cached_chunks);
     std::println("elapsed: {} ms", elapsed_time.count());
 }
+
+void word_count(string const& name, Params const& params, std::function<string()> const& generate_html) {
+    word_count(name, params, [&generate_html](Statistics&) { return generate_html(); });
+}
@@ -0,0 +1,90 @@
+#include <string>
+#include <string_view>
+#include <span>
+#include <random>
+#include <algorithm>
+#include <ranges>
+#include <format>
+
+#include "word-cloud.hxx"
+
+namespace ribomation::wordcount {
+    using std::string;
+    using std::string_view;
+    using std::span;
+
+    namespace {
+        template<typename Weight, typename Title>
+        auto span_tags(Params const& params, std::default_random_engine& R,
+                       span<std::pair<string_view, Weight>> words, Title&& title) -> string {
+            auto html = string{};
+            if (words.empty()) return html;
+
+            auto const [lowest, highest] = std::ranges::minmax(words | std::views::values);
+            auto const scale = highest > lowest
+                               ? static_cast<double>(params.max_font - params.min_font) / (highest - lowest)
+                               : 0.0;
+
+            std::ranges::shuffle(words, R);
+            html.reserve(words.size() * 150);
+            auto Byte = std::uniform_int_distribution<unsigned short>{0, 255};
+            for (auto const& [word, weight]: words) {
+                auto text = html_escaped(word);
+                auto size = static_cast<unsigned>((weight - lowest) * scale + params.min_font);
+                auto colr = std::format("#{:02X}{:02X}{:02X}", Byte(R), Byte(R), Byte(R));
+                constexpr auto fmt = R"(<span style="font-size: {}px; color: {};" title="{}">{}</span>)";
+                html += std::format(fmt, size, colr, title(text, weight), text);
+                html += "\n";
+            }
+            return html;
+        }
+    }
+
+    auto html_escaped(string_view text) -> string {
+        auto result = string{};
+        result.reserve(text.size());
+        for (char ch: text) {
+            switch (ch) {
+                case '<': result += "&lt;"; break;
+                case '>': result += "&gt;"; break;
+                case '&': result += "&amp;"; break;
+                case '"': result += "&quot;"; break;
+                case '\'': result += "&#39;"; break;
+                case '\n': case '\r': case '\t': result += ' '; break;
+                default: result += ch;
+            }
+        }
+        return result;
+    }
+
+    auto WordCloud::head(string_view heading, unsigned refresh_seconds) const -> string {
+        auto html = string{R"(<!DOCTYPE html>
+            <html lang="en">
+                <head>
+                    <meta charset="UTF-8">)"};
+        if (refresh_seconds > 0) {
+            html += std::format(R"(
+                    <meta http-equiv="refresh" content="{}">)", refresh_seconds);
+        }
+        html += R"(
+                    <meta name="viewport" content="width=device-width, initial-scale=1.0, shrink-to-fit=yes">
+                    <title>Word Frequencies</title>
+                </head>
+            <body>)";
+        html += std::format("<h1>{}</h1>\n", html_escaped(heading));
+        return html;
+    }
+
+    auto WordCloud::spans(span<std::pair<string_view, unsigned>> words, string_view noun) -> string {
+        return span_tags(params, R, words, [noun](string_view word, unsigned count) {
+            return std::format("The {} '{}' occurs {} times", noun, word, count);
+        });
+    }
+
+    auto WordCloud::spans(span<std::pair<string_view, double>> words) -> string {
+        return span_tags(params, R, words, [](string_view word, double score) {
+            return std::format("The word '{}' has tf-idf {:.4g}", word, score);
+        });
+    }
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <span>
+#include <random>
+#include <utility>
+#include "params.hxx"
+
+namespace ribomation::wordcount {
+
+    // Text safe in HTML, in an element and in a quoted attribute: markup characters and quotes as entities,
+    // line breaks and tabs as spaces, so a word or a line of context stays on one line.
+    auto html_escaped(std::string_view text) -> std::string;
+
+    // The HTML page of the steps: a head, an <h1> heading and one or more clouds of span tags. A cloud has a span
+    // per word, in random order and a random color, its font size scaled from --min-font for the lowest weight of
+    // the cloud to --max-font for the highest. An empty cloud renders nothing, equal weights all get --min-font.
+    // Headings and words are escaped here, --token-chars may admit '<', '&' or quotes.
+    class WordCloud {
+        Params const& params;
+        std::default_random_engine R{std::random_device{}()};
+
+    public:
+        explicit WordCloud(Params const& params_) : params(params_) {}
+
+        // The page up to and including the heading; a browser reloads it every refresh_seconds, if not 0.
+        [[nodiscard]] auto head(std::string_view heading, unsigned refresh_seconds = 0) const -> std::string;
+
+        [[nodiscard]] static auto tail() -> std::string_view { return "</body></html>\n"; }
+
+        // The counted words as span tags, one per line, shuffled in place; the title calls each a noun.
+        auto spans(std::span<std::pair<std::string_view, unsigned>> words, std::string_view noun = "word") -> std::string;
+
+        // The scored words as span tags, one per line, shuffled in place; the title gives the tf-idf score.
+        auto spans(std::span<std::pair<std::string_view, double>> words) -> std::string;
+    };
+
+}
@@ -0,0 +1,340 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <span>
+#include <istream>
+#include <array>
+#include <iterator>
+#include <algorithm>
+#include <type_traits>
+#include <bit>
+#include <cctype>
+#include <cstdint>
+
+#include "token-class.hxx"
+
+namespace ribomation::wordcount {
+    using namespace std::string_view_literals;
+
+    // Policies of WordIterator. The optimization steps differ in exactly these choices, so a new step is
+    // a policy swap and every combination gets its own fully inlined loop.
+    namespace policy {
+
+        // --- character classes: is_letter(c) ---
+
+        // [A-Za-z'] by a 256-entry table, one load per byte and no branches to mispredict
+        struct AsciiLetters {
+            static constexpr auto table = [] {
+                auto t = std::array<bool, 256>{};
+                for (auto c = 'A'; c <= 'Z'; ++c) t[static_cast<unsigned char>(c)] = true;
+                for (auto c = 'a'; c <= 'z'; ++c) t[static_cast<unsigned char>(c)] = true;
+                t['\''] = true;
+                return t;
+            }();
+
+            static constexpr bool is_letter(char c) { return table[static_cast<unsigned char>(c)]; }
+        };
+
+        // [A-Za-z'] by range compares, as in the char-fn step
+        struct RangeCompare {
+            static constexpr bool is_letter(char c) {
+                const auto ch = static_cast<unsigned char>(c);
+                return ('A' <= ch && ch <= 'Z') || ('a' <= ch && ch <= 'z') || ch == '\'';
+            }
+        };
+
+        // The set given by --token-chars/--token-spec, default_token_chars unless configured. Installed once at start-up,
+        // before any word is read. Provides letters() too, so WordIterator classifies 64 bytes at a time.
+        struct Configured {
+            static constinit inline TokenClass active{default_token_chars};
+
+            static void use(TokenClass const& token_class) { active = token_class; }
+
+            static bool is_letter(char c) { return active.contains(c); }
+
+            static uint64_t letters(char const* text, size_t n) { return active.classify(text, n); }
+        };
+
+        // <cctype> and the C locale, as in the baseline step
+        struct LocaleAlpha {
+            static bool is_letter(char c) {
+                const auto ch = static_cast<unsigned char>(c);
+                return std::isalpha(ch) || ch == '\'';
+            }
+        };
+
+        // --- case folding: in_place tells if words are lower-cased in the source while read ---
+
+        // the payload already is lower-cased, e.g. by kernels::fold_to_lower(), or the caller folds
+        struct PreFolded {
+            static constexpr bool in_place = false;
+
+            static constexpr char fold(char c) { return c; }
+        };
+
+        // A-Z to a-z by a 256-entry table, written back into the source
+        struct FoldInPlace {
+            static constexpr bool in_place = true;
+            static constexpr auto table = [] {
+                auto t = std::array<char, 256>{};
+                for (auto k = 0U; k < 256; ++k) t[k] = static_cast<char>(k);
+                for (auto c = 'A'; c <= 'Z'; ++c) t[static_cast<unsigned char>(c)] = static_cast<char>(c - 'A' + 'a');
+                return t;
+            }();
+
+            static constexpr char fold(char c) { return table[static_cast<unsigned char>(c)]; }
+        };
+
+        // <cctype> and the C locale, written back into the source
+        struct LocaleFold {
+            static constexpr bool in_place = true;
+
+            static char fold(char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); }
+        };
+
+        // --- word filters: keep(word), applied after the length check ---
+
+        struct KeepAll {
+            static constexpr bool keep(std::string_view) { return true; }
+        };
+
+        // Drops the words of the Project Gutenberg license. A handful of words compared by length first
+        // is cheaper than hashing every word for a set lookup.
+        struct NotModern {
+            static constexpr auto modern_words = std::array{
+                "electronic"sv, "distributed"sv, "copies"sv, "copyright"sv, "gutenberg"sv
+            };
+
+            static constexpr bool keep(std::string_view word) {
+                return std::ranges::find(modern_words, word) == modern_words.end();
+            }
+        };
+    }
+
+    // A character class that can classify a block of up to 64 bytes into a bit mask, bit k for byte k.
+    template<typename CharClass>
+    concept BlockClassifier = requires(char const* text, size_t n) {
+        { CharClass::letters(text, n) } -> std::same_as<uint64_t>;
+    };
+
+    // Min length given at run-time, see for_each_word() for compile-time dispatch.
+    inline constexpr unsigned runtime_min_length = 0U;
+
+    // Splits a contiguous buffer (Source: span<char>, or span<char const> unless folding in place) into words of
+    // CharClass letters of at least MinLength that pass Filter; views into the buffer, folded by CaseFold.
+    template<typename Source, typename CharClass, typename CaseFold, typename Filter, unsigned MinLength = runtime_min_length>
+    class WordIterator {
+        static_assert(not CaseFold::in_place || not std::is_const_v<typename Source::element_type>,
+                      "folding in place needs a writable source");
+        using Char = typename Source::element_type;
+
+        Char* pos = nullptr;
+        Char* end = nullptr;
+        unsigned min_length_ = MinLength;
+        std::string_view current_word{};
+        bool at_end = true;
+        Char* window = nullptr;     // the 64 bytes last classified by a BlockClassifier
+        uint64_t window_letters = 0;
+
+        [[nodiscard]] constexpr auto min_length() const -> unsigned {
+            if constexpr (MinLength == runtime_min_length) return min_length_;
+            else return MinLength;
+        }
+
+        [[nodiscard]] auto window_end() const -> Char* { return end - window < 64 ? end : window + 64; }
+
+        // letters from p to the end of its window, bit 0 for p
+        auto letters_at(Char* p) -> uint64_t {
+            if (p >= window_end()) {
+                window = p;
+                window_letters = CharClass::letters(p, static_cast<size_t>(window_end() - p));
+            }
+            return window_letters >> (p - window);
+        }
+
+        // Word boundaries by bit scans of a classified window, instead of a branch per byte.
+        void skip_to_word() requires BlockClassifier<CharClass> {
+            while (pos != end) {
+                if (auto bits = letters_at(pos); bits != 0) {
+                    pos += std::countr_zero(bits);
+                    return;
+                }
+                pos = window_end();
+            }
+        }
+
+        void skip_word() requires BlockClassifier<CharClass> {
+            while (pos != end) {
+                pos += std::countr_one(letters_at(pos));
+                if (pos != window_end()) return;
+            }
+        }
+
+        void skip_to_word() {
+            while (pos != end && not CharClass::is_letter(*pos)) ++pos;
+        }
+
+        void skip_word() {
+            while (pos != end && CharClass::is_letter(*pos)) ++pos;
+        }
+
+        void read_next() {
+            while (true) {
+                skip_to_word();
+                if (pos == end) {
+                    at_end = true;
+                    current_word = {};
+                    return;
+                }
+
+                auto start = pos;
+                skip_word();
+                if constexpr (CaseFold::in_place) {
+                    for (auto p = start; p != pos; ++p) *p = CaseFold::fold(*p);
+                }
+
+                auto word = std::string_view{start, static_cast<size_t>(pos - start)};
+                if (word.size() < min_length() || not Filter::keep(word)) continue;
+
+                current_word = word;
+                at_end = false;
+                return;
+            }
+        }
+
+    public:
+        using iterator_concept = std::input_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::string_view;
+        using reference = value_type;
+        using pointer = void;
+        using difference_type = std::ptrdiff_t;
+
+        WordIterator() = default;
+
+        // min_length_ is ignored when MinLength is fixed at compile-time
+        explicit WordIterator(Source payload, unsigned min_length = MinLength)
+            : pos(payload.data()), end(payload.data() + payload.size()), min_length_(min_length), window(pos) {
+            if constexpr (BlockClassifier<CharClass>) {
+                if (pos != end) window_letters = CharClass::letters(pos, static_cast<size_t>(window_end() - pos));
+            }
+            read_next();
+        }
+
+        reference operator*() const { return current_word; }
+
+        WordIterator& operator++() {
+            read_next();
+            return *this;
+        }
+
+        WordIterator operator++(int) {
+            auto tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        friend bool operator==(WordIterator const& a, WordIterator const& b) {
+            if (a.at_end && b.at_end) return true;
+            return a.at_end == b.at_end && a.pos == b.pos;
+        }
+
+        static constexpr bool is_letter(char c) { return CharClass::is_letter(c); }
+    };
+
+    // Reads the words of a stream one char at a time (Source: std::istream), as the first steps do. Each word is
+    // copied into the iterator, folded by CaseFold on the way, so it stays valid while the stream is read on.
+    template<typename CharClass, typename CaseFold, typename Filter, unsigned MinLength>
+    class WordIterator<std::istream, CharClass, CaseFold, Filter, MinLength> {
+        std::istream* input = nullptr;
+        unsigned min_length_ = MinLength;
+        std::string current_word{};
+        bool at_end = true;
+
+        [[nodiscard]] constexpr auto min_length() const -> unsigned {
+            if constexpr (MinLength == runtime_min_length) return min_length_;
+            else return MinLength;
+        }
+
+        void read_next() {
+            while (input != nullptr) {
+                current_word.clear();
+                for (char ch; input->get(ch);) {
+                    if (CharClass::is_letter(ch)) {
+                        current_word.push_back(CaseFold::fold(ch));
+                        break;
+                    }
+                }
+                if (current_word.empty()) break;
+
+                // the non-letter ending a word is consumed, it cannot start the next one
+                for (char ch; input->get(ch) && CharClass::is_letter(ch);) current_word.push_back(CaseFold::fold(ch));
+                if (current_word.size() < min_length() || not Filter::keep(current_word)) continue;
+
+                at_end = false;
+                return;
+            }
+            input = nullptr;
+            at_end = true;
+        }
+
+    public:
+        using iterator_concept = std::input_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::string;
+        using reference = std::string const&;
+        using pointer = std::string const*;
+        using difference_type = std::ptrdiff_t;
+
+        WordIterator() = default;
+
+        // min_length_ is ignored when MinLength is fixed at compile-time
+        explicit WordIterator(std::istream& in, unsigned min_length = MinLength) : input(&in), min_length_(min_length) {
+            read_next();
+        }
+
+        reference operator*() const { return current_word; }
+
+        pointer operator->() const { return &current_word; }
+
+        WordIterator& operator++() {
+            read_next();
+            return *this;
+        }
+
+        WordIterator operator++(int) {
+            auto tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        friend bool operator==(WordIterator const& a, WordIterator const& b) {
+            if (a.at_end || b.at_end) return a.at_end == b.at_end;
+            return a.input == b.input;
+        }
+
+        static constexpr bool is_letter(char c) { return CharClass::is_letter(c); }
+    };
+
+    // Calls consume(word) for every word of payload. The common min lengths 1..8 each get a loop with the
+    // length as a constant, other lengths share one with the length in a register.
+    template<typename Source, typename CharClass, typename CaseFold, typename Filter, typename Consumer>
+    void for_each_word(Source payload, unsigned min_length, Consumer&& consume) {
+        auto run = [&]<unsigned MinLength>() {
+            using Iterator = WordIterator<Source, CharClass, CaseFold, Filter, MinLength>;
+            for (auto it = Iterator{payload, min_length}; it != Iterator{}; ++it) consume(*it);
+        };
+        switch (min_length) {
+            case 1: return run.template operator()<1>();
+            case 2: return run.template operator()<2>();
+            case 3: return run.template operator()<3>();
+            case 4: return run.template operator()<4>();
+            case 5: return run.template operator()<5>();
+            case 6: return run.template operator()<6>();
+            case 7: return run.template operator()<7>();
+            case 8: return run.template operator()<8>();
+            default: return run.template operator()<runtime_min_length>();
+        }
+    }
+
+}
@@ -0,0 +1,235 @@
+#pragma once
+#include <version>
+#if not defined(__cpp_lib_generator)
+#error "word-source.hxx needs std::generator, i.e. a C++23 library such as libstdc++ of GCC 14 or later"
+#endif
+
+#include <string>
+#include <string_view>
+#include <span>
+#include <array>
+#include <vector>
+#include <filesystem>
+#include <stdexcept>
+#include <generator>
+#include <algorithm>
+#include <ranges>
+#include <thread>
+#include <semaphore>
+#include <exception>
+#include <utility>
+#include <optional>
+
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include "word-iterator.hxx"
+
+// Word sources as coroutines. Each stage is a std::generator, i.e. an input range, so reading, tokenizing,
+// filtering and counting compose with range-for and views. A generator frame is allocated once per source,
+// suspending and resuming it neither allocates nor goes through a virtual call.
+namespace ribomation::wordcount::source {
+    namespace fs = std::filesystem;
+    namespace r = std::ranges;
+    using namespace std::string_literals;
+    using std::string_view;
+    using std::span;
+
+    using Letters = policy::Configured;
+    using Filter = policy::NotModern;
+
+    // Words are handed over in batches, so resuming a coroutine is paid once per batch rather than per word,
+    // and the per-word loop of words() below is the inlined inner loop of a join.
+    constexpr auto batch_size = 256UL;
+    using Batch = span<string_view const>;
+
+    // Batches of the words of an already case-folded buffer, e.g. a memory-mapped file; views into the buffer.
+    inline auto word_batches(span<char> text, unsigned min_length) -> std::generator<Batch> {
+        using Iterator = WordIterator<span<char>, Letters, policy::PreFolded, Filter>;
+        auto batch = std::array<string_view, batch_size>{};
+        auto n = 0UL;
+        for (auto it = Iterator{text, min_length}; it != Iterator{}; ++it) {
+            batch[n++] = *it;
+            if (n == batch.size()) co_yield Batch{batch.data(), std::exchange(n, 0)};
+        }
+        if (n > 0) co_yield Batch{batch.data(), n};
+    }
+
+    // Batches of the words of a stream of blocks, lower-cased in the block. A batch is valid until the next
+    // one is pulled; a word spanning two blocks is assembled in a buffer of its own.
+    inline auto word_batches(std::generator<span<char>> blocks, unsigned min_length) -> std::generator<Batch> {
+        using Iterator = WordIterator<span<char>, Letters, policy::FoldInPlace, Filter>;
+        auto keep = [min_length](string_view word) { return word.size() >= min_length && Filter::keep(word); };
+        auto append_folded = [](std::string& word, span<char const> letters) {
+            r::transform(letters, std::back_inserter(word), policy::FoldInPlace::fold);
+        };
+
+        auto batch = std::array<string_view, batch_size>{};
+        auto n = 0UL;
+        auto partial = std::string{};
+        for (span<char> block: blocks) {
+            auto head = 0UL;
+            if (not partial.empty()) {
+                head = static_cast<size_t>(r::find_if_not(block, Letters::is_letter) - block.begin());
+                append_folded(partial, block.first(head));
+                if (head == block.size()) continue;
+                if (keep(partial)) batch[n++] = partial;
+            }
+
+            auto tail = block.size();
+            while (tail > head && Letters::is_letter(block[tail - 1])) --tail;
+            for (auto it = Iterator{block.subspan(head, tail - head), min_length}; it != Iterator{}; ++it) {
+                batch[n++] = *it;
+                if (n == batch.size()) co_yield Batch{batch.data(), std::exchange(n, 0)};
+            }
+            // the block is about to be reused and the partial word overwritten
+            if (n > 0) co_yield Batch{batch.data(), std::exchange(n, 0)};
+            partial.clear();
+            append_folded(partial, block.subspan(tail));
+        }
+        if (not partial.empty() && keep(partial)) {
+            batch[0] = partial;
+            co_yield Batch{batch.data(), 1};
+        }
+    }
+
+    // Words of an already case-folded buffer, one at a time.
+    inline auto words(span<char> text, unsigned min_length) {
+        return word_batches(text, min_length) | std::views::join;
+    }
+
+    // Words of a stream of blocks, one at a time; each is valid until the next block is pulled.
+    inline auto words(std::generator<span<char>> blocks, unsigned min_length) {
+        return word_batches(std::move(blocks), min_length) | std::views::join;
+    }
+
+    // Fills the buffer unless the file ends first, returns the number of bytes read.
+    inline auto read_fully(int fd, span<char> buffer) -> size_t {
+        auto total = 0UL;
+        while (total < buffer.size()) {
+            auto n = read(fd, buffer.data() + total, buffer.size() - total);
+            if (n == 0) break;
+            if (n == -1) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error{"read failed: "s + strerror(errno)};
+            }
+            total += static_cast<size_t>(n);
+        }
+        return total;
+    }
+
+    // As read_fully(), but waits for input in poll(2) together with wake_fd, and gives up with nullopt once that
+    // becomes readable. A read from a pipe, FIFO or terminal can block for as long as the writer pleases; this way
+    // it can still be abandoned.
+    inline auto read_fully(int fd, span<char> buffer, int wake_fd) -> std::optional<size_t> {
+        auto total = 0UL;
+        while (total < buffer.size()) {
+            pollfd ready[]{{fd, POLLIN, 0}, {wake_fd, POLLIN, 0}};
+            if (poll(ready, 2, -1) == -1) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error{"poll failed: "s + strerror(errno)};
+            }
+            if (ready[1].revents != 0) return std::nullopt;
+
+            auto n = read(fd, buffer.data() + total, buffer.size() - total);
+            if (n == 0) break;
+            if (n == -1) {
+                if (errno == EINTR || errno == EAGAIN) continue;
+                throw std::runtime_error{"read failed: "s + strerror(errno)};
+            }
+            total += static_cast<size_t>(n);
+        }
+        return total;
+    }
+
+    inline auto open_file(fs::path const& filename) -> int {
+        auto fd = open(filename.string().c_str(), O_RDONLY);
+        if (fd == -1) throw std::invalid_argument{"cannot open "s + filename.string()};
+        return fd;
+    }
+
+    // Blocks of a file, read when pulled; each is valid until the next one is pulled.
+    inline auto blocks(fs::path filename, size_t block_size) -> std::generator<span<char>> {
+        struct File {
+            int fd;
+            ~File() { close(fd); }
+        } file{open_file(filename)};
+
+        auto buffer = std::vector<char>(block_size);
+        while (auto n = read_fully(file.fd, buffer)) co_yield span{buffer.data(), n};
+    }
+
+    // Blocks of a file, while a background thread reads the next one into a second buffer. Pulling a block
+    // waits only when the consumer is ahead of the reader; each is valid until the next one is pulled.
+    // A consumer that stops early must not wait for the reader's read(2), which on a pipe or FIFO blocks until the
+    // writer sends more or closes; the reader therefore waits in poll(2) on a wake-up pipe as well.
+    inline auto prefetched_blocks(fs::path filename, size_t block_size) -> std::generator<span<char>> {
+        struct Slot {
+            std::vector<char> data;
+            size_t size = 0;
+            std::exception_ptr error{};
+        };
+        struct File {
+            int fd;
+            ~File() { close(fd); }
+        } file{open_file(filename)};
+        struct WakeUp {
+            int fds[2]{-1, -1};
+            WakeUp() {
+                if (pipe(fds) == -1) throw std::runtime_error{"cannot create pipe: "s + strerror(errno)};
+            }
+            ~WakeUp() {
+                close(fds[0]);
+                close(fds[1]);
+            }
+        } wake_up{};
+
+        auto slots = std::array<Slot, 2>{Slot{std::vector<char>(block_size)}, Slot{std::vector<char>(block_size)}};
+        auto free_slots = std::counting_semaphore<>{static_cast<std::ptrdiff_t>(slots.size())};
+        auto filled_slots = std::counting_semaphore<>{0};
+
+        auto reader = std::jthread{[&](std::stop_token stop) {
+            for (auto k = 0UL;; ++k) {
+                free_slots.acquire();
+                if (stop.stop_requested()) return;
+                auto& slot = slots[k % slots.size()];
+                try {
+                    auto n = read_fully(file.fd, slot.data, wake_up.fds[0]);
+                    if (not n) return;
+                    slot.size = *n;
+                } catch (...) {
+                    slot.size = 0;
+                    slot.error = std::current_exception();
+                }
+                filled_slots.release();
+                if (slot.size == 0) return;
+            }
+        }};
+        // A consumer that stops early destroys this frame; wake the reader, whether it waits for a free slot or
+        // for input, so it can see the stop request before it is joined.
+        struct StopReader {
+            std::jthread& reader;
+            std::counting_semaphore<>& free_slots;
+            int wake_fd;
+            ~StopReader() {
+                reader.request_stop();
+                free_slots.release();
+                [[maybe_unused]] auto n = write(wake_fd, "", 1);
+            }
+        } stop_reader{reader, free_slots, wake_up.fds[1]};
+
+        for (auto k = 0UL;; ++k) {
+            filled_slots.acquire();
+            auto& slot = slots[k % slots.size()];
+            if (slot.error) std::rethrow_exception(slot.error);
+            if (slot.size == 0) break;
+            co_yield span{slot.data.data(), slot.size};
+            free_slots.release();
+        }
+    }
+
+}
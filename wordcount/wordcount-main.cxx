@@ -0,0 +1,28 @@
+#include <string>
+#include <functional>
+#include <print>
+#include "params.hxx"
+#include "statistics.hxx"
+#include "engines.hxx"
+
+using namespace std::string_literals;
+using std::string;
+using ribomation::wordcount::Params;
+using ribomation::wordcount::Statistics;
+
+extern void word_count(string const& name, Params const& params, std::function<string(Statistics&)> const& generate_html);
+
+int main(int argc, char* argv[]) {
+    auto params = Params{};
+    params.parse(argc, argv);
+
+    if (params.engine == "list"s) {
+        for (auto const& engine: ribomation::wordcount::engines()) std::println("{:<16} {}", engine.name, engine.title);
+        return 0;
+    }
+
+    auto const& engine = ribomation::wordcount::select_engine(params);
+    word_count(string{engine.title}, params, [&params, &engine](Statistics& stats) {
+        return engine.run(params, stats);
+    });
+}